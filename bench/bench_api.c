@@ -0,0 +1,93 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Latency of individual public API calls.
+ * Every line is reported as "<api>,<min cycles>,<median cycles>,<p99 cycles>",
+ * with the overhead of the timestamp reads already subtracted.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#include "bench_utils.h"
+#include <cpu/cpu.h>
+#include <efitest/efitest.h>
+
+#define BENCH_NUM_SAMPLES 1000
+#define BENCH_NUM_WARMUP 16
+
+// 64-bit LCG constants from Knuth's MMIX, so consecutive samples see unrelated inputs
+#define BENCH_LCG_MULTIPLIER 6364136223846793005ULL
+#define BENCH_LCG_INCREMENT 1442695040888963407ULL
+
+// NOLINTBEGIN
+static cpu_u64 g_samples[BENCH_NUM_SAMPLES];
+static volatile cpu_u64 g_sink; // Keeps results alive so calls aren't optimized out
+static volatile cpu_u64 g_input;// Advanced between samples so calls can't be hoisted
+// NOLINTEND
+
+// The cheapest empty sample, which is subtracted from every measurement
+static cpu_u64 bench_get_overhead() {
+    BENCH_SAMPLE(g_samples, BENCH_NUM_SAMPLES, (void) 0);
+    bench_sort(g_samples, BENCH_NUM_SAMPLES);
+    return g_samples[0];
+}
+
+static void bench_report(const char* name, cpu_u64 overhead) {
+    const BenchStats stats = bench_summarize(g_samples, BENCH_NUM_SAMPLES, overhead);
+    efitest_logln(L"%a,%lu,%lu,%lu", name, stats.min, stats.median, stats.p99);
+}
+
+// Warms up caches and lazily initialized state before sampling, setup runs outside of the timed region
+#define BENCH_API_SETUP(name, setup, statement)                                                                        \
+    do {                                                                                                               \
+        const cpu_u64 overhead = bench_get_overhead();                                                                 \
+        BENCH_SAMPLE_SETUP(g_samples, BENCH_NUM_WARMUP, setup, statement);                                             \
+        BENCH_SAMPLE_SETUP(g_samples, BENCH_NUM_SAMPLES, setup, statement);                                            \
+        bench_report(name, overhead);                                                                                  \
+    } while(0)
+
+#define BENCH_API(name, statement) BENCH_API_SETUP(name, (void) 0, statement)
+
+ETEST_DEFINE_TEST(bench_get_features) {
+    BENCH_API("cpu_get_features", {
+        const CPUFeatureSet features = cpu_get_features();
+        g_sink = features.words[0];
+    });
+}
+
+ETEST_DEFINE_TEST(bench_get_vendor) {
+    BENCH_API("cpu_get_vendor", g_sink = cpu_get_vendor());
+}
+
+ETEST_DEFINE_TEST(bench_popcnt) {
+    // Varying inputs so the calls can't be hoisted out of the sampling loop
+    g_input = 1;
+    BENCH_API_SETUP("cpu_popcnt16", g_input = g_input * BENCH_LCG_MULTIPLIER + BENCH_LCG_INCREMENT,
+                    g_sink = cpu_popcnt16((cpu_u16) g_input));
+    BENCH_API_SETUP("cpu_popcnt32", g_input = g_input * BENCH_LCG_MULTIPLIER + BENCH_LCG_INCREMENT,
+                    g_sink = cpu_popcnt32((cpu_u32) g_input));
+    BENCH_API_SETUP("cpu_popcnt64", g_input = g_input * BENCH_LCG_MULTIPLIER + BENCH_LCG_INCREMENT,
+                    g_sink = cpu_popcnt64(g_input));
+}
+
+ETEST_DEFINE_TEST(bench_hint_spin) {
+    BENCH_API("cpu_hint_spin", cpu_hint_spin());
+}
+
+ETEST_DEFINE_TEST(bench_init) {
+    const CPUFeatureSet features = cpu_get_features();
+    // Without a reset, every call after the first one only takes the early return
+    BENCH_API_SETUP("cpu_init", cpu_reset_state(), cpu_init(features));
+}
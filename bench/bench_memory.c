@@ -0,0 +1,87 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Throughput of cpu_memcpy, cpu_memmove and cpu_memset from 8 B up to 64 MiB.
+ * Every line is reported as "<api>,<size>,<cycles per call>,<bytes per 1000 cycles>".
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#include "bench_utils.h"
+#include <cpu/cpu.h>
+#include <efitest/efitest.h>
+
+#define BENCH_MIN_SIZE ((cpu_usize) 8)
+#define BENCH_MAX_SIZE ((cpu_usize) 64 << 20)
+#define BENCH_BYTES_PER_RUN ((cpu_usize) 64 << 20)// Amount of data moved per timed run
+#define BENCH_MIN_ITERATIONS 4
+#define BENCH_NUM_RUNS 5
+
+typedef enum _BenchMemoryOp {
+    BENCH_MEMORY_OP_MEMCPY,
+    BENCH_MEMORY_OP_MEMMOVE,
+    BENCH_MEMORY_OP_MEMSET
+} BenchMemoryOp;
+
+// NOLINTBEGIN
+alignas(64) static cpu_u8 g_src[BENCH_MAX_SIZE];
+alignas(64) static cpu_u8 g_dst[BENCH_MAX_SIZE];
+// NOLINTEND
+
+// Returns the fewest cycles a run of the given number of iterations took
+static cpu_u64 bench_memory_run(BenchMemoryOp op, cpu_usize size, cpu_usize num_iterations) {
+    cpu_u64 best_cycles = (cpu_u64) -1;
+    for(cpu_usize run = 0; run < BENCH_NUM_RUNS; ++run) {
+        const cpu_u64 start = bench_timestamp();
+        for(cpu_usize iteration = 0; iteration < num_iterations; ++iteration) {
+            switch(op) {
+                case BENCH_MEMORY_OP_MEMCPY: cpu_memcpy(g_dst, g_src, size); break;
+                case BENCH_MEMORY_OP_MEMMOVE: cpu_memmove(g_dst, g_dst + 1, size - 1); break;
+                case BENCH_MEMORY_OP_MEMSET: cpu_memset(g_dst, (cpu_u8) iteration, size); break;
+            }
+        }
+        const cpu_u64 cycles = bench_timestamp() - start;
+        if(cycles < best_cycles) {
+            best_cycles = cycles;
+        }
+    }
+    return best_cycles;
+}
+
+static void bench_memory(BenchMemoryOp op, const char* name) {
+    cpu_init(cpu_get_features());// Make sure the fastest tier is selected
+    for(cpu_usize size = BENCH_MIN_SIZE; size <= BENCH_MAX_SIZE; size <<= 1) {
+        cpu_usize num_iterations = BENCH_BYTES_PER_RUN / size;
+        if(num_iterations < BENCH_MIN_ITERATIONS) {
+            num_iterations = BENCH_MIN_ITERATIONS;
+        }
+        const cpu_u64 cycles = bench_memory_run(op, size, num_iterations);
+        const cpu_u64 cycles_per_call = cycles / num_iterations;
+        const cpu_u64 bytes_per_kcycle = cycles == 0 ? 0 : ((cpu_u64) size * num_iterations * 1000) / cycles;
+        efitest_logln(L"%a,%lu,%lu,%lu", name, (cpu_u64) size, cycles_per_call, bytes_per_kcycle);
+    }
+}
+
+ETEST_DEFINE_TEST(bench_memcpy) {
+    bench_memory(BENCH_MEMORY_OP_MEMCPY, "cpu_memcpy");
+}
+
+ETEST_DEFINE_TEST(bench_memmove) {
+    bench_memory(BENCH_MEMORY_OP_MEMMOVE, "cpu_memmove");
+}
+
+ETEST_DEFINE_TEST(bench_memset) {
+    bench_memory(BENCH_MEMORY_OP_MEMSET, "cpu_memset");
+}
@@ -0,0 +1,102 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Shared helpers for the libcpu benchmarks.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#pragma once
+
+#include <cpu/cpu.h>
+#include <cpu/cpu_x86.h>
+
+/**
+ * Read the timestamp counter after all preceding instructions have completed.
+ * @return The current value of the timestamp counter.
+ */
+static inline cpu_u64 bench_timestamp() {
+    return cpu_rdtsc_lfence();
+}
+
+/**
+ * Summary of a series of timed samples, in cycles.
+ */
+typedef struct _BenchStats {
+    cpu_u64 min;
+    cpu_u64 median;
+    cpu_u64 p99;
+} BenchStats;
+
+/**
+ * Time the given statement num_samples times, each sample being bracketed
+ * by serialized timestamp counter reads.
+ * @param samples The array which receives the number of cycles per sample.
+ * @param num_samples The number of samples to take.
+ * @param setup The statement to run before every sample, outside of the timed region.
+ * @param statement The statement to time.
+ */
+#define BENCH_SAMPLE_SETUP(samples, num_samples, setup, statement)                                                    \
+    for(cpu_usize _sample = 0; _sample < (num_samples); ++_sample) {                                                   \
+        setup;                                                                                                         \
+        const cpu_u64 _start = bench_timestamp();                                                                      \
+        statement;                                                                                                     \
+        (samples)[_sample] = bench_timestamp() - _start;                                                               \
+    }
+
+/**
+ * Time the given statement num_samples times, each sample being bracketed
+ * by serialized timestamp counter reads.
+ * @param samples The array which receives the number of cycles per sample.
+ * @param num_samples The number of samples to take.
+ * @param statement The statement to time.
+ */
+#define BENCH_SAMPLE(samples, num_samples, statement) BENCH_SAMPLE_SETUP(samples, num_samples, (void) 0, statement)
+
+/**
+ * Sort the given samples in ascending order.
+ * Insertion sort, the sample counts are small and mostly pre-sorted.
+ * @param samples The samples to sort.
+ * @param num_samples The number of samples.
+ */
+static inline void bench_sort(cpu_u64* samples, cpu_usize num_samples) {
+    for(cpu_usize index = 1; index < num_samples; ++index) {
+        const cpu_u64 value = samples[index];
+        cpu_usize position = index;
+        while(position > 0 && samples[position - 1] > value) {
+            samples[position] = samples[position - 1];
+            --position;
+        }
+        samples[position] = value;
+    }
+}
+
+/**
+ * Sort the given samples and summarize them, subtracting the given
+ * measurement overhead from every statistic.
+ * @param samples The samples to summarize, sorted in place.
+ * @param num_samples The number of samples, must not be 0.
+ * @param overhead The number of cycles an empty sample takes.
+ * @return The minimum, median and 99th percentile of the samples.
+ */
+static inline BenchStats bench_summarize(cpu_u64* samples, cpu_usize num_samples, cpu_u64 overhead) {
+    bench_sort(samples, num_samples);
+    const cpu_u64 values[3] = {samples[0], samples[num_samples / 2], samples[(num_samples * 99) / 100]};
+    cpu_u64 results[3];
+    for(cpu_usize index = 0; index < 3; ++index) {
+        results[index] = values[index] > overhead ? values[index] - overhead : 0;
+    }
+    return (BenchStats){results[0], results[1], results[2]};
+}
@@ -23,35 +23,176 @@
 
 LCPU_API_BEGIN
 
-typedef enum _CPUFeature : cpu_u32 {// clang-format off
-    CPU_FEATURE_NONE        = 0,
-    CPU_FEATURE_X87         = 1,
-    CPU_FEATURE_MMX         = 1 << 1,
-    CPU_FEATURE_SSE         = 1 << 2,
-    CPU_FEATURE_SSE2        = 1 << 3,
-    CPU_FEATURE_SSE3        = 1 << 4,
-    CPU_FEATURE_SSSE3       = 1 << 5,
-    CPU_FEATURE_SSE4_1      = 1 << 6,
-    CPU_FEATURE_SSE4_2      = 1 << 7,
-    CPU_FEATURE_SSE4A       = 1 << 8,
-    CPU_FEATURE_AVX         = 1 << 9,
-    CPU_FEATURE_AVX2        = 1 << 10,
-    CPU_FEATURE_AVX512      = 1 << 11,
-    CPU_FEATURE_FMA3        = 1 << 12,
-    CPU_FEATURE_FMA4        = 1 << 13,
-    CPU_FEATURE_FXSR        = 1 << 14,
-    CPU_FEATURE_XSAVE       = 1 << 15,
-    CPU_FEATURE_NX          = 1 << 16,
-    CPU_FEATURE_RDRND       = 1 << 17,
-    CPU_FEATURE_RDSEED      = 1 << 18,
-    CPU_FEATURE_RDTSC       = 1 << 19,
-    CPU_FEATURE_CX8         = 1 << 20,
-    CPU_FEATURE_CX16        = 1 << 21,
-    CPU_FEATURE_MONITOR     = 1 << 22,
-    CPU_FEATURE_POPCNT      = 1 << 23,
-    CPU_FEATURE_NEON        = 1 << 24,
-    CPU_FEATURE_RVV         = 1 << 25
-} CPUFeature; // clang-format off
+typedef enum _CPUFeature : cpu_u16 {// clang-format off
+    // Common features
+    CPU_FEATURE_X87 = 0,
+    CPU_FEATURE_MMX,
+    CPU_FEATURE_SSE,
+    CPU_FEATURE_SSE2,
+    CPU_FEATURE_SSE3,
+    CPU_FEATURE_SSSE3,
+    CPU_FEATURE_SSE4_1,
+    CPU_FEATURE_SSE4_2,
+    CPU_FEATURE_SSE4A,
+    CPU_FEATURE_AVX,
+    CPU_FEATURE_AVX2,
+    CPU_FEATURE_AVX512,
+    CPU_FEATURE_FMA3,
+    CPU_FEATURE_FMA4,
+    CPU_FEATURE_FXSR,
+    CPU_FEATURE_XSAVE,
+    CPU_FEATURE_NX,
+    CPU_FEATURE_RDRND,
+    CPU_FEATURE_RDSEED,
+    CPU_FEATURE_RDTSC,
+    CPU_FEATURE_CX8,
+    CPU_FEATURE_CX16,
+    CPU_FEATURE_MONITOR,
+    CPU_FEATURE_POPCNT,
+    CPU_FEATURE_NEON,
+    CPU_FEATURE_RVV,
+    // x86 leaf 1 (EDX)
+    CPU_FEATURE_PSE,
+    CPU_FEATURE_MSR,
+    CPU_FEATURE_PAE,
+    CPU_FEATURE_APIC,
+    CPU_FEATURE_SEP,
+    CPU_FEATURE_MTRR,
+    CPU_FEATURE_PGE,
+    CPU_FEATURE_CMOV,
+    CPU_FEATURE_PAT,
+    CPU_FEATURE_CLFSH,
+    CPU_FEATURE_HTT,
+    // x86 leaf 1 (ECX)
+    CPU_FEATURE_PCLMULQDQ,
+    CPU_FEATURE_VMX,
+    CPU_FEATURE_SMX,
+    CPU_FEATURE_EST,
+    CPU_FEATURE_PCID,
+    CPU_FEATURE_X2APIC,
+    CPU_FEATURE_MOVBE,
+    CPU_FEATURE_TSC_DEADLINE,
+    CPU_FEATURE_AES,
+    CPU_FEATURE_OSXSAVE,
+    CPU_FEATURE_F16C,
+    CPU_FEATURE_HYPERVISOR,
+    // x86 leaf 7:0 (EBX)
+    CPU_FEATURE_FSGSBASE,
+    CPU_FEATURE_SGX,
+    CPU_FEATURE_BMI1,
+    CPU_FEATURE_HLE,
+    CPU_FEATURE_SMEP,
+    CPU_FEATURE_BMI2,
+    CPU_FEATURE_ERMS,
+    CPU_FEATURE_INVPCID,
+    CPU_FEATURE_RTM,
+    CPU_FEATURE_AVX512DQ,
+    CPU_FEATURE_ADX,
+    CPU_FEATURE_SMAP,
+    CPU_FEATURE_AVX512IFMA,
+    CPU_FEATURE_CLFLUSHOPT,
+    CPU_FEATURE_CLWB,
+    CPU_FEATURE_PT,
+    CPU_FEATURE_AVX512PF,
+    CPU_FEATURE_AVX512ER,
+    CPU_FEATURE_AVX512CD,
+    CPU_FEATURE_SHA,
+    CPU_FEATURE_AVX512BW,
+    CPU_FEATURE_AVX512VL,
+    // x86 leaf 7:0 (ECX)
+    CPU_FEATURE_PREFETCHWT1,
+    CPU_FEATURE_AVX512VBMI,
+    CPU_FEATURE_UMIP,
+    CPU_FEATURE_PKU,
+    CPU_FEATURE_WAITPKG,
+    CPU_FEATURE_AVX512VBMI2,
+    CPU_FEATURE_CET_SS,
+    CPU_FEATURE_GFNI,
+    CPU_FEATURE_VAES,
+    CPU_FEATURE_VPCLMULQDQ,
+    CPU_FEATURE_AVX512VNNI,
+    CPU_FEATURE_AVX512BITALG,
+    CPU_FEATURE_AVX512VPOPCNTDQ,
+    CPU_FEATURE_LA57,
+    CPU_FEATURE_RDPID,
+    CPU_FEATURE_CLDEMOTE,
+    CPU_FEATURE_MOVDIRI,
+    CPU_FEATURE_MOVDIR64B,
+    CPU_FEATURE_ENQCMD,
+    // x86 leaf 7:0 (EDX)
+    CPU_FEATURE_AVX512_4VNNIW,
+    CPU_FEATURE_AVX512_4FMAPS,
+    CPU_FEATURE_FSRM,
+    CPU_FEATURE_UINTR,
+    CPU_FEATURE_AVX512VP2INTERSECT,
+    CPU_FEATURE_MD_CLEAR,
+    CPU_FEATURE_SERIALIZE,
+    CPU_FEATURE_HYBRID,
+    CPU_FEATURE_TSXLDTRK,
+    CPU_FEATURE_CET_IBT,
+    CPU_FEATURE_AMX_BF16,
+    CPU_FEATURE_AVX512FP16,
+    CPU_FEATURE_AMX_TILE,
+    CPU_FEATURE_AMX_INT8,
+    // x86 leaf 7:1 (EAX)
+    CPU_FEATURE_AVX_VNNI,
+    CPU_FEATURE_AVX512BF16,
+    CPU_FEATURE_CMPCCXADD,
+    CPU_FEATURE_FZLRM,
+    CPU_FEATURE_FSRS,
+    CPU_FEATURE_FSRCS,
+    CPU_FEATURE_AMX_FP16,
+    CPU_FEATURE_HRESET,
+    CPU_FEATURE_AVX_IFMA,
+    CPU_FEATURE_LAM,
+    // x86 leaf 0xD:1 (EAX)
+    CPU_FEATURE_XSAVEOPT,
+    CPU_FEATURE_XSAVEC,
+    CPU_FEATURE_XSAVES,
+    // x86 leaf 0x80000001 (ECX/EDX)
+    CPU_FEATURE_LAHF_LM,
+    CPU_FEATURE_SVM,
+    CPU_FEATURE_LZCNT,
+    CPU_FEATURE_MISALIGNSSE,
+    CPU_FEATURE_PREFETCHW,
+    CPU_FEATURE_XOP,
+    CPU_FEATURE_TBM,
+    CPU_FEATURE_TOPOEXT,
+    CPU_FEATURE_PERFCTR_CORE,
+    CPU_FEATURE_MONITORX,
+    CPU_FEATURE_SYSCALL,
+    CPU_FEATURE_MMXEXT,
+    CPU_FEATURE_PDPE1GB,
+    CPU_FEATURE_RDTSCP,
+    CPU_FEATURE_LM,
+    // x86 leaf 0x80000007 (EDX)
+    CPU_FEATURE_INVARIANT_TSC,
+    CPU_FEATURE_CPB,
+    // x86 leaf 0x80000008 (EBX)
+    CPU_FEATURE_CLZERO,
+    CPU_FEATURE_INVLPGB,
+    CPU_FEATURE_RDPRU,
+    CPU_FEATURE_MCOMMIT,
+    CPU_FEATURE_WBNOINVD,
+    CPU_FEATURE_COUNT// Number of known features, not a feature itself
+} CPUFeature;// clang-format on
+
+// Number of 32-bit words required to hold one bit per known feature
+#define CPU_FEATURE_SET_NUM_WORDS ((CPU_FEATURE_COUNT + 31) >> 5)
+
+/**
+ * A set of CPU features with one bit per CPUFeature value.
+ * Use the cpu_feature_set_* functions to query and modify it.
+ * A zero-initialized set contains no features.
+ */
+typedef struct _CPUFeatureSet {
+    cpu_u32 words[CPU_FEATURE_SET_NUM_WORDS];
+} CPUFeatureSet;
+
+typedef enum _CPUIdleHint : cpu_u8 {
+    CPU_IDLE_HINT_SHALLOW,// Lowest wakeup latency (C1)
+    CPU_IDLE_HINT_DEEP    // Deepest state advertised by the processor
+} CPUIdleHint;
 
 typedef enum _CPUVendor {
     CPU_VENDOR_UNKNOWN,
@@ -79,6 +220,55 @@ typedef enum _CPUVendor {
     CPU_VENDOR_MSXTA
 } CPUVendor;
 
+typedef enum _CPUCacheType {
+    CPU_CACHE_TYPE_DATA,
+    CPU_CACHE_TYPE_INSTRUCTION,
+    CPU_CACHE_TYPE_UNIFIED
+} CPUCacheType;
+
+/**
+ * Describes a single cache of the current processor.
+ */
+typedef struct _CPUCache {
+    CPUCacheType type;
+    cpu_u32 level;        // 1 for L1, 2 for L2 and so on
+    cpu_usize size;       // Total size in bytes
+    cpu_u32 line_size;    // Size of a single cache line in bytes
+    cpu_u32 associativity;// Number of ways, equal to the number of lines if fully associative
+    cpu_u32 num_sets;
+    cpu_u32 num_sharing;// Maximum number of logical processors sharing this cache
+    cpu_bool is_inclusive;
+    cpu_bool is_fully_associative;
+} CPUCache;
+
+#define CPU_MAX_CACHES 8
+
+/**
+ * The cache hierarchy of the current processor, ordered by level.
+ */
+typedef struct _CPUCacheInfo {
+    cpu_usize num_caches;
+    CPUCache caches[CPU_MAX_CACHES];
+} CPUCacheInfo;
+
+/**
+ * The position of a logical processor within the processor topology.
+ * Levels the processor doesn't report span the entire next level,
+ * so their ID is always 0 and their thread count equals the one of the next level.
+ */
+typedef struct _CPUTopology {
+    cpu_u32 apic_id;
+    cpu_u32 smt_id;    // Within the core
+    cpu_u32 core_id;   // Within the module
+    cpu_u32 module_id; // Within the die
+    cpu_u32 die_id;    // Within the package
+    cpu_u32 package_id;// System-wide
+    cpu_u32 threads_per_core;
+    cpu_u32 threads_per_module;
+    cpu_u32 threads_per_die;
+    cpu_u32 threads_per_package;
+} CPUTopology;
+
 typedef enum _CPUException {
     CPU_EXCEPTION_NONE,
     CPU_EXCEPTION_PAGE_FAULT,
@@ -116,14 +306,16 @@ CPUVendor cpu_get_vendor();
 const char* cpu_vendor_get_name(CPUVendor vendor);
 
 /**
- * @return A bitmask of features available on the current processor.
+ * @return The set of features available on the current processor.
  */
-CPUFeature cpu_get_features();
+CPUFeatureSet cpu_get_features();
 
 /**
- * @return A bitmask of features currently enabled on the current processor.
+ * Features passed to cpu_init() whose register state could not be enabled
+ * (e.g. AVX-512 without the opmask and ZMM components in XCR0) are not part of this set.
+ * @return The set of features currently enabled on the current processor.
  */
-CPUFeature cpu_get_enabled_features();
+CPUFeatureSet cpu_get_enabled_features();
 
 /**
  * @return An array of all available CPU features on the current architecture.
@@ -138,12 +330,55 @@ const CPUFeature* cpu_get_available_features();
 cpu_usize cpu_get_num_available_features();
 
 /**
- * Convert the given feature bit to a null-terminated string.
- * @param feature The feature bit to convert.
- * @return A null-terminated string representation of the given feature bit.
+ * Convert the given feature to a null-terminated string.
+ * @param feature The feature to convert.
+ * @return A null-terminated string representation of the given feature.
  */
 const char* cpu_feature_get_name(CPUFeature feature);
 
+/**
+ * Retrieve the cache hierarchy of the current processor.
+ * On x86 it is decoded from CPUID leaf 4 (Intel) or 0x8000001D (AMD),
+ * falling back to the legacy leaves 0x80000005/0x80000006.
+ * On ARM and RISC-V the hierarchy is not enumerated and no caches are reported.
+ * The result is enumerated once and stays valid until cpu_reset_state() is called.
+ * @return The cache hierarchy of the current processor.
+ *  Contains no caches if they could not be enumerated.
+ */
+const CPUCacheInfo* cpu_get_cache_info();
+
+/**
+ * Find the cache of the given level which holds the given type of data.
+ * Unified caches match data and instruction queries.
+ * @param level The level of the cache, 1 for L1 and so on.
+ * @param type The type of the cache.
+ * @return The matching cache or nullptr if there is none.
+ */
+const CPUCache* cpu_get_cache(cpu_u32 level, CPUCacheType type);
+
+/**
+ * @return The line size of the L1 data cache in bytes.
+ *  Suitable for padding data structures to avoid false sharing.
+ *  Defaults to 64 bytes if it can't be determined.
+ */
+cpu_usize cpu_get_cacheline_size();
+
+/**
+ * @return The APIC ID of the current processor.
+ *  On x86 this is the x2APIC ID if the extended topology leaves are available.
+ */
+cpu_u32 cpu_get_apic_id();
+
+/**
+ * Decompose the given APIC ID into the IDs of the individual topology levels.
+ * On x86 the layout is decoded once from CPUID leaf 0x1F or 0xB,
+ * falling back to leaf 0x8000001E on AMD processors.
+ * On ARM and RISC-V every processor is reported as a single-threaded package.
+ * @param apic_id The APIC ID of the logical processor, see cpu_get_apic_id().
+ * @return The topology of the given logical processor.
+ */
+CPUTopology cpu_get_topology(cpu_u32 apic_id);
+
 /**
  * Resets the internal state of the current processor.
  * This can be used after transitioning from firmware to kernel for example.
@@ -154,12 +389,25 @@ void cpu_reset_state();
  * Initialize the current processor with the given features.
  * For enabling all features, a call to cpu_get_features()
  * should be passed in.
- * @param features A bitmask of features to enable on the current processor.
+ * Only the first call chooses the feature configuration, which is shared by all processors.
+ * Later calls on other processors behave like cpu_init_ap().
+ * @param features The set of features to enable on the current processor.
  */
-void cpu_init(CPUFeature features);
+void cpu_init(CPUFeatureSet features);
 
 /**
- * @return True if the CPU has already been initialized.
+ * Initialize the current application processor with the features
+ * passed to cpu_init() on the bootstrap processor.
+ * Safe to call concurrently from all processors during SMP bring-up.
+ * On ARM and RISC-V there is no per-core state to replay, so this only reports
+ * whether cpu_init() was called.
+ * @return True if the current processor was initialized, false if
+ *  cpu_init() was not called yet.
+ */
+cpu_bool cpu_init_ap();
+
+/**
+ * @return True if the current processor has already been initialized.
  */
 cpu_bool cpu_is_initialized();
 
@@ -183,11 +431,22 @@ CPUExceptionHandler cpu_get_exception_handler();
 void cpu_hint_spin();
 
 /**
- * Halts the current processor in an infinite loop.
+ * Disables interrupts and halts the current processor,
+ * so it only consumes idle power from now on.
+ * In usermode, this spins in an infinite loop instead.
  * This functions does not return.
  */
 _Noreturn void cpu_halt();
 
+/**
+ * Puts the current processor into a low power state until the next interrupt arrives.
+ * Interrupts are enabled atomically with entering the low power state,
+ * so an interrupt arriving in between can't be missed.
+ * In usermode, this only hints a spin-loop.
+ * @param hint Whether to prefer a low wakeup latency or the lowest power draw.
+ */
+void cpu_idle(CPUIdleHint hint);
+
 /**
  * Enters userland code execution on the current processor.
  * This should ideally be called after initializing a kernel
@@ -199,6 +458,8 @@ void cpu_enter_usermode();
 /**
  * Determines whether the current processor is operating in userland.
  * This function will always return true after cpu_enter_userland() was called.
+ * Only identifies the current processor if some but not all processors entered userland,
+ * otherwise processors which never called cpu_init() or cpu_enter_usermode() share the common answer.
  * @return True if the current processor is operating in userland.
  */
 cpu_bool cpu_is_usermode();
@@ -227,4 +488,167 @@ cpu_usize cpu_popcnt32(cpu_u32 value);
  */
 cpu_usize cpu_popcnt64(cpu_u64 value);
 
+/**
+ * Count the number of 1-bits in the given buffer.
+ * Uses the fastest vectorized kernel for the features passed to cpu_init(),
+ * which is resolved once during initialization.
+ * @param data The buffer to count 1-bits in.
+ * @param size The size of the given buffer in bytes.
+ * @return The number of set 1-bits in the given buffer.
+ */
+cpu_u64 cpu_popcnt_buffer(const void* data, cpu_usize size);
+
+/**
+ * Count the number of 1-bits in the bitwise AND of the given buffers,
+ * without materializing the intermediate result.
+ * Uses the same kernels as cpu_popcnt_buffer().
+ * @param data The first buffer.
+ * @param mask The second buffer, which must be at least as large as the first one.
+ * @param size The size of the given buffers in bytes.
+ * @return The number of set 1-bits in (data & mask).
+ */
+cpu_u64 cpu_popcnt_buffer_and(const void* data, const void* mask, cpu_usize size);
+
+/**
+ * Copy size bytes from src to dst. The buffers must not overlap.
+ * Dispatches to rep movsb (ERMS/FSRM), unrolled vector loops or streaming stores
+ * for buffers exceeding the shared cache, depending on the features passed to cpu_init().
+ * Before initialization, a portable string instruction fallback is used.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param size The number of bytes to copy.
+ * @return The destination buffer.
+ */
+void* cpu_memcpy(void* dst, const void* src, cpu_usize size);
+
+/**
+ * Copy size bytes from src to dst. The buffers may overlap.
+ * Uses the same kernels as cpu_memcpy(), overlapping buffers
+ * are moved front to back or back to front as required.
+ * @param dst The destination buffer.
+ * @param src The source buffer.
+ * @param size The number of bytes to copy.
+ * @return The destination buffer.
+ */
+void* cpu_memmove(void* dst, const void* src, cpu_usize size);
+
+/**
+ * Fill size bytes at dst with the given value.
+ * Uses the same tiers as cpu_memcpy().
+ * @param dst The buffer to fill.
+ * @param value The byte value to fill the buffer with.
+ * @param size The number of bytes to fill.
+ * @return The destination buffer.
+ */
+void* cpu_memset(void* dst, cpu_u8 value, cpu_usize size);
+
+/**
+ * Determine whether the given feature is part of the given set.
+ * @param set The set to test.
+ * @param feature The feature to test for.
+ * @return True if the given feature is part of the given set.
+ */
+static inline cpu_bool cpu_feature_set_test(const CPUFeatureSet* set, CPUFeature feature) {
+    return (set->words[feature >> 5] & (1U << (feature & 31))) != 0;
+}
+
+/**
+ * Add the given feature to the given set.
+ * @param set The set to modify.
+ * @param feature The feature to add.
+ */
+static inline void cpu_feature_set_set(CPUFeatureSet* set, CPUFeature feature) {
+    set->words[feature >> 5] |= 1U << (feature & 31);
+}
+
+/**
+ * Remove the given feature from the given set.
+ * @param set The set to modify.
+ * @param feature The feature to remove.
+ */
+static inline void cpu_feature_set_clear(CPUFeatureSet* set, CPUFeature feature) {
+    set->words[feature >> 5] &= ~(1U << (feature & 31));
+}
+
+/**
+ * Compute the intersection of two feature sets.
+ * The destination may alias either of the operands.
+ * @param dst The set to store the features present in both sets in.
+ * @param set1 The first set.
+ * @param set2 The second set.
+ */
+static inline void cpu_feature_set_intersect(CPUFeatureSet* dst, const CPUFeatureSet* set1, const CPUFeatureSet* set2) {
+    for(cpu_usize index = 0; index < CPU_FEATURE_SET_NUM_WORDS; ++index) {
+        dst->words[index] = set1->words[index] & set2->words[index];
+    }
+}
+
+/**
+ * Compute the union of two feature sets.
+ * The destination may alias either of the operands.
+ * @param dst The set to store the features present in either set in.
+ * @param set1 The first set.
+ * @param set2 The second set.
+ */
+static inline void cpu_feature_set_union(CPUFeatureSet* dst, const CPUFeatureSet* set1, const CPUFeatureSet* set2) {
+    for(cpu_usize index = 0; index < CPU_FEATURE_SET_NUM_WORDS; ++index) {
+        dst->words[index] = set1->words[index] | set2->words[index];
+    }
+}
+
+/**
+ * Determine whether all features of the given subset are part of the given set.
+ * @param set The set to test.
+ * @param subset The features to test for.
+ * @return True if every feature in subset is also part of set.
+ */
+static inline cpu_bool cpu_feature_set_contains(const CPUFeatureSet* set, const CPUFeatureSet* subset) {
+    for(cpu_usize index = 0; index < CPU_FEATURE_SET_NUM_WORDS; ++index) {
+        if((set->words[index] & subset->words[index]) != subset->words[index]) {
+            return LCPU_FALSE;
+        }
+    }
+    return LCPU_TRUE;
+}
+
+/**
+ * Determine whether two feature sets contain exactly the same features.
+ * @param set1 The first set.
+ * @param set2 The second set.
+ * @return True if both sets are equal.
+ */
+static inline cpu_bool cpu_feature_set_equals(const CPUFeatureSet* set1, const CPUFeatureSet* set2) {
+    for(cpu_usize index = 0; index < CPU_FEATURE_SET_NUM_WORDS; ++index) {
+        if(set1->words[index] != set2->words[index]) {
+            return LCPU_FALSE;
+        }
+    }
+    return LCPU_TRUE;
+}
+
+/**
+ * @param set The set to test.
+ * @return True if the given set contains no features at all.
+ */
+static inline cpu_bool cpu_feature_set_is_empty(const CPUFeatureSet* set) {
+    for(cpu_usize index = 0; index < CPU_FEATURE_SET_NUM_WORDS; ++index) {
+        if(set->words[index] != 0) {
+            return LCPU_FALSE;
+        }
+    }
+    return LCPU_TRUE;
+}
+
+/**
+ * @param set The set to count the features of.
+ * @return The number of features in the given set.
+ */
+static inline cpu_usize cpu_feature_set_count(const CPUFeatureSet* set) {
+    cpu_usize count = 0;
+    for(cpu_usize index = 0; index < CPU_FEATURE_SET_NUM_WORDS; ++index) {
+        count += cpu_popcnt32(set->words[index]);
+    }
+    return count;
+}
+
 LCPU_API_END
\ No newline at end of file
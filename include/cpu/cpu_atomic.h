@@ -0,0 +1,204 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Atomic operations and spinlocks built on them.
+ * Everything in here is inline, so atomics compile down to single locked instructions.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#pragma once
+
+#include "cpu.h"
+
+LCPU_API_BEGIN
+
+typedef enum _CPUMemoryOrder : cpu_u8 {
+    CPU_MEMORY_ORDER_RELAXED = __ATOMIC_RELAXED,
+    CPU_MEMORY_ORDER_ACQUIRE = __ATOMIC_ACQUIRE,
+    CPU_MEMORY_ORDER_RELEASE = __ATOMIC_RELEASE,
+    CPU_MEMORY_ORDER_ACQ_REL = __ATOMIC_ACQ_REL,
+    CPU_MEMORY_ORDER_SEQ_CST = __ATOMIC_SEQ_CST
+} CPUMemoryOrder;
+
+/**
+ * Issue a memory fence of the given order.
+ * @param order The memory order to enforce.
+ */
+static inline void cpu_atomic_fence(CPUMemoryOrder order) {
+    __atomic_thread_fence(order);
+}
+
+// clang-format off
+#define LCPU_DEFINE_ATOMIC(s, t)                                                                        \
+    static inline t cpu_atomic_load##s(const volatile t* address, CPUMemoryOrder order) {               \
+        return __atomic_load_n(address, order);                                                         \
+    }                                                                                                   \
+    static inline void cpu_atomic_store##s(volatile t* address, t value, CPUMemoryOrder order) {        \
+        __atomic_store_n(address, value, order);                                                        \
+    }                                                                                                   \
+    static inline t cpu_atomic_exchange##s(volatile t* address, t value, CPUMemoryOrder order) {        \
+        return __atomic_exchange_n(address, value, order);                                              \
+    }                                                                                                   \
+    static inline t cpu_atomic_fetch_add##s(volatile t* address, t value, CPUMemoryOrder order) {       \
+        return __atomic_fetch_add(address, value, order);                                               \
+    }                                                                                                   \
+    static inline cpu_bool cpu_atomic_compare_exchange##s(volatile t* address, t* expected, t desired,  \
+                                                          CPUMemoryOrder order) {                       \
+        /* The failure order may not be stronger than the success order or contain a release */         \
+        const int failure_order = order == CPU_MEMORY_ORDER_RELEASE   ? __ATOMIC_RELAXED                \
+                                  : order == CPU_MEMORY_ORDER_ACQ_REL ? __ATOMIC_ACQUIRE                \
+                                                                      : order;                          \
+        return __atomic_compare_exchange_n(address, expected, desired, false, order, failure_order);    \
+    }
+// clang-format on
+
+/**
+ * Load, store, exchange, fetch_add and compare_exchange for 8, 16, 32 and 64 bit values
+ * and pointer sized integers, e.g. cpu_atomic_fetch_add32(address, value, order).
+ * The compare_exchange functions store the current value into expected on failure.
+ */
+LCPU_DEFINE_ATOMIC(8, cpu_u8)
+LCPU_DEFINE_ATOMIC(16, cpu_u16)
+LCPU_DEFINE_ATOMIC(32, cpu_u32)
+LCPU_DEFINE_ATOMIC(64, cpu_u64)
+LCPU_DEFINE_ATOMIC(size, cpu_usize)
+
+#undef LCPU_DEFINE_ATOMIC
+
+#if defined(CPU_X86) && defined(CPU_64_BIT)
+
+/**
+ * A 128-bit value which can be swapped atomically, for example a pointer
+ * and a generation counter to avoid ABA problems.
+ */
+typedef struct _CPUAtomic128 {
+    alignas(16) cpu_u64 low;
+    cpu_u64 high;
+} CPUAtomic128;
+
+/**
+ * Atomically compare and exchange a 128-bit value using CMPXCHG16B.
+ * Always sequentially consistent, requires CPU_FEATURE_CX16.
+ * @param address The 16-byte aligned value to exchange.
+ * @param expected The value to compare against, receives the current value on failure.
+ * @param desired The value to store if the comparison succeeds.
+ * @return True if the value was exchanged.
+ */
+static inline cpu_bool cpu_atomic_compare_exchange128(volatile CPUAtomic128* address, CPUAtomic128* expected,
+                                                      CPUAtomic128 desired) {
+    cpu_bool result;
+    __asm__ __volatile__("lock cmpxchg16b %[value]; setz %[result]"
+                         : [value] "+m"(*address), [result] "=q"(result), "+a"(expected->low), "+d"(expected->high)
+                         : "b"(desired.low), "c"(desired.high)
+                         : "memory", "cc");
+    return result;
+}
+
+#endif// CPU_X86 && CPU_64_BIT
+
+/**
+ * A fair spinlock which grants the lock in the order it was requested.
+ * Waiters spin on a single shared word, which keeps it cheap for a handful of cores.
+ */
+typedef struct _CPUTicketLock {
+    volatile cpu_u32 next; // Next ticket handed out
+    volatile cpu_u32 owner;// Ticket currently holding the lock
+} CPUTicketLock;
+
+#define CPU_TICKET_LOCK_INIT {0, 0}
+
+static inline void cpu_ticket_lock_acquire(CPUTicketLock* lock) {
+    const cpu_u32 ticket = cpu_atomic_fetch_add32(&lock->next, 1, CPU_MEMORY_ORDER_RELAXED);
+    while(true) {
+        const cpu_u32 owner = cpu_atomic_load32(&lock->owner, CPU_MEMORY_ORDER_ACQUIRE);
+        if(owner == ticket) {
+            return;
+        }
+        // Back off proportionally to the number of waiters ahead of us
+        for(cpu_u32 index = ticket - owner; index > 0; --index) {
+            cpu_hint_spin();
+        }
+    }
+}
+
+static inline cpu_bool cpu_ticket_lock_try_acquire(CPUTicketLock* lock) {
+    cpu_u32 owner = cpu_atomic_load32(&lock->owner, CPU_MEMORY_ORDER_RELAXED);
+    cpu_u32 expected = owner;
+    return cpu_atomic_compare_exchange32(&lock->next, &expected, owner + 1, CPU_MEMORY_ORDER_ACQUIRE);
+}
+
+static inline void cpu_ticket_lock_release(CPUTicketLock* lock) {
+    // Only the holder writes the owner, so no read-modify-write is required
+    const cpu_u32 owner = cpu_atomic_load32(&lock->owner, CPU_MEMORY_ORDER_RELAXED);
+    cpu_atomic_store32(&lock->owner, owner + 1, CPU_MEMORY_ORDER_RELEASE);
+}
+
+/**
+ * A waiter of an MCS lock, usually living on the stack of the acquiring function.
+ * The same node has to be passed to the matching release.
+ */
+typedef struct _CPUMCSNode {
+    struct _CPUMCSNode* volatile next;
+    volatile cpu_u32 is_locked;
+} CPUMCSNode;
+
+/**
+ * A fair queued spinlock where every waiter spins on its own node,
+ * so handing over the lock only touches the cache line of the next waiter.
+ * Scales to many cores where test-and-set and ticket locks collapse under contention.
+ */
+typedef struct _CPUMCSLock {
+    CPUMCSNode* volatile tail;
+} CPUMCSLock;
+
+#define CPU_MCS_LOCK_INIT {nullptr}
+
+static inline void cpu_mcs_lock_acquire(CPUMCSLock* lock, CPUMCSNode* node) {
+    node->next = nullptr;
+    node->is_locked = LCPU_TRUE;
+    CPUMCSNode* previous = __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+    if(previous == nullptr) {
+        return;
+    }
+    __atomic_store_n(&previous->next, node, __ATOMIC_RELEASE);
+    while(cpu_atomic_load32(&node->is_locked, CPU_MEMORY_ORDER_ACQUIRE)) {
+        cpu_hint_spin();
+    }
+}
+
+static inline cpu_bool cpu_mcs_lock_try_acquire(CPUMCSLock* lock, CPUMCSNode* node) {
+    node->next = nullptr;
+    node->is_locked = LCPU_FALSE;
+    CPUMCSNode* expected = nullptr;
+    return __atomic_compare_exchange_n(&lock->tail, &expected, node, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static inline void cpu_mcs_lock_release(CPUMCSLock* lock, CPUMCSNode* node) {
+    CPUMCSNode* next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    if(next == nullptr) {
+        CPUMCSNode* expected = node;
+        if(__atomic_compare_exchange_n(&lock->tail, &expected, nullptr, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;// No waiters
+        }
+        // A waiter swapped the tail but didn't link itself yet
+        while((next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE)) == nullptr) {
+            cpu_hint_spin();
+        }
+    }
+    cpu_atomic_store32(&next->is_locked, LCPU_FALSE, CPU_MEMORY_ORDER_RELEASE);
+}
+
+LCPU_API_END
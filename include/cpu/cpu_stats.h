@@ -0,0 +1,97 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Call counters of the libcpu API, only available when the library
+ * is built with CPU_ENABLE_INSTRUMENTATION.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#pragma once
+
+#include "cpu.h"
+
+#ifdef CPU_ENABLE_INSTRUMENTATION
+
+LCPU_API_BEGIN
+
+#define CPU_STATS_NUM_BUCKETS 32
+
+typedef enum _CPUStatsAPI : cpu_u8 {
+    CPU_STATS_API_GET_CPUID_LEAF = 0,
+    CPU_STATS_API_GET_GPR_WIDTH,
+    CPU_STATS_API_GET_VR_WIDTH,
+    CPU_STATS_API_GET_VENDOR,
+    CPU_STATS_API_VENDOR_GET_NAME,
+    CPU_STATS_API_GET_HYPERVISOR,
+    CPU_STATS_API_GET_HYPERVISOR_MAX_LEAF,
+    CPU_STATS_API_GET_FEATURES,
+    CPU_STATS_API_GET_ENABLED_FEATURES,
+    CPU_STATS_API_GET_AVAILABLE_FEATURES,
+    CPU_STATS_API_GET_NUM_AVAILABLE_FEATURES,
+    CPU_STATS_API_FEATURE_GET_NAME,
+    CPU_STATS_API_RESET_STATE,
+    CPU_STATS_API_INIT,
+    CPU_STATS_API_INIT_AP,
+    CPU_STATS_API_IS_INITIALIZED,
+    CPU_STATS_API_SET_EXCEPTION_HANDLER,
+    CPU_STATS_API_GET_EXCEPTION_HANDLER,
+    CPU_STATS_API_HINT_SPIN,
+    CPU_STATS_API_ENTER_USERMODE,
+    CPU_STATS_API_IS_USERMODE,
+    CPU_STATS_API_POPCNT16,
+    CPU_STATS_API_POPCNT32,
+    CPU_STATS_API_POPCNT64,
+    CPU_STATS_API_POPCNT_BUFFER,
+    CPU_STATS_API_POPCNT_BUFFER_AND,
+    CPU_STATS_API_COUNT// Number of instrumented functions
+} CPUStatsAPI;
+
+/**
+ * Counters of a single instrumented function.
+ */
+typedef struct _CPUStatsEntry {
+    cpu_u64 num_calls;
+    cpu_u64 num_cycles;// Total TSC cycles spent inside the function
+    // Number of calls which took [2^n, 2^(n+1)) cycles,
+    // only populated when built with CPU_ENABLE_INSTRUMENTATION_HISTOGRAM
+    cpu_u64 histogram[CPU_STATS_NUM_BUCKETS];
+} CPUStatsEntry;
+
+typedef struct _CPUStats {
+    CPUStatsEntry entries[CPU_STATS_API_COUNT];
+} CPUStats;
+
+/**
+ * Copy the current counters of all instrumented functions.
+ * Counters of calls which are in flight on other cores may be missing.
+ * @param stats The structure which receives the counters.
+ */
+void cpu_stats_snapshot(CPUStats* stats);
+
+/**
+ * Reset the counters of all instrumented functions to zero.
+ */
+void cpu_stats_reset();
+
+/**
+ * @param api The instrumented function to retrieve the name of.
+ * @return The name of the given function.
+ */
+const char* cpu_stats_get_api_name(CPUStatsAPI api);
+
+LCPU_API_END
+
+#endif// CPU_ENABLE_INSTRUMENTATION
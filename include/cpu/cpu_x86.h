@@ -0,0 +1,830 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * x86 specific extensions to the libcpu API.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#pragma once
+
+#include "cpu.h"
+
+#ifdef CPU_X86
+
+LCPU_API_BEGIN
+
+/**
+ * The raw register values returned by a single CPUID leaf/sub-leaf pair.
+ */
+typedef struct _CPUIDLeaf {
+    cpu_u32 eax;
+    cpu_u32 ebx;
+    cpu_u32 ecx;
+    cpu_u32 edx;
+} CPUIDLeaf;
+
+/**
+ * Retrieve the raw register values of the given CPUID leaf.
+ * Results are served from the snapshot libcpu takes on first use,
+ * so repeated calls do not execute CPUID again.
+ * Leaves beyond the range reported by the processor yield all zeroes.
+ * Values which differ between logical processors (like APIC IDs)
+ * reflect the processor which performed the enumeration.
+ * @param leaf The leaf to query (value of EAX).
+ * @param sub_leaf The sub-leaf to query (value of ECX).
+ * @return The register values of the given leaf.
+ */
+CPUIDLeaf cpu_get_cpuid_leaf(cpu_u32 leaf, cpu_u32 sub_leaf);
+
+/**
+ * Identify the hypervisor the current processor runs under, using the hypervisor
+ * bit of CPUID leaf 1 and the signature of leaf 0x40000000.
+ * Detected once together with the vendor, so this never executes CPUID again.
+ * @return The vendor of the hypervisor, CPU_VENDOR_UNKNOWN on bare metal or
+ *  if it isn't recognized (check CPU_FEATURE_HYPERVISOR to tell these apart).
+ */
+CPUVendor cpu_get_hypervisor();
+
+/**
+ * @return The highest hypervisor CPUID leaf (0x4000XXXX) supported by the
+ *  current hypervisor, or 0 on bare metal.
+ */
+cpu_u32 cpu_get_hypervisor_max_leaf();
+
+/**
+ * A reference clock used to calibrate the timestamp counter.
+ * @return A monotonic timestamp in nanoseconds.
+ */
+typedef cpu_u64 (*CPUTimeSource)();
+
+/**
+ * Read the timestamp counter without any ordering guarantees.
+ * The read may be executed before preceding or after following instructions.
+ * @return The current value of the timestamp counter.
+ */
+static inline cpu_u64 cpu_rdtsc() {
+    cpu_u32 low;
+    cpu_u32 high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((cpu_u64) high << 32) | low;
+}
+
+/**
+ * Read the timestamp counter once all preceding instructions have executed.
+ * Following instructions are not executed before the read either.
+ * @param aux Receives the value of the TSC_AUX MSR (usually the processor ID), may be nullptr.
+ * @return The current value of the timestamp counter.
+ */
+static inline cpu_u64 cpu_rdtscp(cpu_u32* aux) {
+    cpu_u32 low;
+    cpu_u32 high;
+    cpu_u32 value;
+    __asm__ __volatile__("rdtscp; lfence" : "=a"(low), "=d"(high), "=c"(value) : : "memory");
+    if(aux != nullptr) {
+        *aux = value;
+    }
+    return ((cpu_u64) high << 32) | low;
+}
+
+/**
+ * Read the timestamp counter fenced by LFENCE on both sides,
+ * so it is ordered against all surrounding instructions but not against pending stores.
+ * Use this at the start of a measured region.
+ * @return The current value of the timestamp counter.
+ */
+static inline cpu_u64 cpu_rdtsc_lfence() {
+    cpu_u32 low;
+    cpu_u32 high;
+    __asm__ __volatile__("lfence; rdtsc; lfence" : "=a"(low), "=d"(high) : : "memory");
+    return ((cpu_u64) high << 32) | low;
+}
+
+/**
+ * Read the timestamp counter after MFENCE and LFENCE, so all preceding loads
+ * and stores are globally visible before the read.
+ * Also serializes on AMD processors which don't treat LFENCE as dispatch serializing.
+ * @return The current value of the timestamp counter.
+ */
+static inline cpu_u64 cpu_rdtsc_mfence() {
+    cpu_u32 low;
+    cpu_u32 high;
+    __asm__ __volatile__("mfence; lfence; rdtsc; lfence" : "=a"(low), "=d"(high) : : "memory");
+    return ((cpu_u64) high << 32) | low;
+}
+
+/**
+ * @return True if the timestamp counter runs at a constant rate in all ACPI P-, C- and T-states.
+ */
+cpu_bool cpu_is_tsc_invariant();
+
+/**
+ * Retrieve the frequency of the timestamp counter.
+ * It is discovered from CPUID leaf 0x15/0x16 or the hypervisor timing leaf
+ * on first use, unless it was calibrated or set explicitly.
+ * @return The frequency of the timestamp counter in Hz, or 0 if unknown.
+ */
+cpu_u64 cpu_get_tsc_frequency();
+
+/**
+ * Override the frequency of the timestamp counter, for example
+ * with a value obtained from the firmware.
+ * @param frequency The frequency of the timestamp counter in Hz.
+ */
+void cpu_set_tsc_frequency(cpu_u64 frequency);
+
+/**
+ * Measure the frequency of the timestamp counter against the given reference clock
+ * by spinning for the given duration, and use it from now on.
+ * This is a fallback for processors which don't report their TSC frequency.
+ * @param time_source The reference clock to calibrate against.
+ * @param duration_ns The duration of the calibration in nanoseconds, at least one tick of the time source.
+ * @return The measured frequency of the timestamp counter in Hz.
+ */
+cpu_u64 cpu_calibrate_tsc(CPUTimeSource time_source, cpu_u64 duration_ns);
+
+/**
+ * Convert the given number of TSC cycles into nanoseconds.
+ * Uses a precomputed multiplier and shift, so the conversion never divides.
+ * @param cycles The number of cycles to convert.
+ * @return The number of nanoseconds, or 0 if the TSC frequency is unknown.
+ */
+cpu_u64 cpu_cycles_to_ns(cpu_u64 cycles);
+
+#define CPU_MWAIT_MAX_CSTATES 8
+
+/**
+ * The capabilities of MONITOR/MWAIT as reported by CPUID leaf 5.
+ */
+typedef struct _CPUMwaitInfo {
+    cpu_u32 min_monitor_size;    // Smallest monitor line size in bytes
+    cpu_u32 max_monitor_size;    // Largest monitor line size in bytes
+    cpu_bool has_interrupt_break;// Interrupts wake MWAIT even when masked
+    // Number of sub-states per MWAIT C-state, starting at C0, all zero if not enumerated
+    cpu_u8 num_sub_states[CPU_MWAIT_MAX_CSTATES];
+} CPUMwaitInfo;
+
+/**
+ * @return The capabilities of MONITOR/MWAIT, or nullptr if they aren't supported.
+ */
+const CPUMwaitInfo* cpu_get_mwait_info();
+
+/**
+ * Retrieve the MWAIT hint (value of EAX) which is used by cpu_idle() for the given idle hint.
+ * @param hint The idle hint to translate.
+ * @return The MWAIT hint, C1 if no deeper states are enumerated.
+ */
+cpu_u32 cpu_get_mwait_hint(CPUIdleHint hint);
+
+#define CPU_SPIN_FOREVER ((cpu_u64) -1)
+
+/**
+ * How quickly a waiting processor has to react once the awaited condition is met.
+ * Selects the optimized state used by TPAUSE/UMWAIT when WAITPKG is available.
+ */
+typedef enum _CPUSpinLatency : cpu_u8 {
+    CPU_SPIN_LATENCY_LOW,// C0.1, faster wakeup and doesn't impair the SMT sibling
+    CPU_SPIN_LATENCY_HIGH// C0.2, slower wakeup but saves more power
+} CPUSpinLatency;
+
+/**
+ * A condition awaited by cpu_spin_until().
+ * @param context The context pointer passed to cpu_spin_until().
+ * @return True once the condition is met.
+ */
+typedef cpu_bool (*CPUSpinPredicate)(void* context);
+
+/**
+ * Spin until the given predicate is met or the timeout expires.
+ * The processor backs off exponentially between polls, calibrated to the
+ * latency of PAUSE, and sleeps in TPAUSE once fully backed off if WAITPKG is available.
+ * @param predicate The condition to wait for.
+ * @param context The context pointer passed to the predicate.
+ * @param timeout_cycles The maximum number of TSC cycles to wait, or CPU_SPIN_FOREVER.
+ * @param latency The wakeup latency required by the caller.
+ * @return True if the predicate was met, false if the timeout expired.
+ */
+cpu_bool cpu_spin_until(CPUSpinPredicate predicate, void* context, cpu_u64 timeout_cycles, CPUSpinLatency latency);
+
+/**
+ * Spin until the value at the given address equals the expected value or the timeout expires.
+ * Behaves like cpu_spin_until(), but waits for the write using UMONITOR/UMWAIT
+ * once fully backed off if WAITPKG is available.
+ * @param address The address of the value to observe.
+ * @param expected The value to wait for.
+ * @param timeout_cycles The maximum number of TSC cycles to wait, or CPU_SPIN_FOREVER.
+ * @param latency The wakeup latency required by the caller.
+ * @return True if the expected value was observed, false if the timeout expired.
+ */
+cpu_bool cpu_spin_until_equal(const volatile cpu_u32* address, cpu_u32 expected, cpu_u64 timeout_cycles,
+                              CPUSpinLatency latency);
+
+/**
+ * Wait until the value at the given address differs from the expected value or the deadline passes.
+ * Arms MONITOR on the cache line holding the value and sleeps in MWAIT until it is written,
+ * so waking up only costs a single cache line transfer.
+ * Falls back to cpu_spin_until() if MONITOR/MWAIT isn't available, in usermode,
+ * or if the value straddles the monitored line.
+ * While sleeping, the deadline is only checked whenever an interrupt wakes the processor.
+ * @param address The address of the 64-bit value to observe, should be naturally aligned.
+ * @param expected The value to wait on.
+ * @param deadline The TSC value to stop waiting at, or CPU_SPIN_FOREVER.
+ * @return True if the value changed, false if the deadline passed.
+ */
+cpu_bool cpu_wait_on_address(const volatile void* address, cpu_u64 expected, cpu_u64 deadline);
+
+/**
+ * Retrieve the ID of the current processor as cheaply as possible.
+ * Uses RDPID or RDTSCP once cpu_percpu_init() stored the ID in TSC_AUX of the current processor,
+ * and executes CPUID otherwise, so processors which didn't run cpu_percpu_init() still get their own ID.
+ * @return The APIC ID of the current processor.
+ */
+cpu_u32 cpu_current_id();
+
+#define CPU_XSTATE_ALIGNMENT 64
+
+/**
+ * Retrieve the size of a save area for cpu_xstate_save(), covering every
+ * state component enabled in XCR0 in the format of the selected save instruction.
+ * Enumerated from CPUID leaf 0xD by cpu_init() and cpu_reset_state().
+ * @return The size of a save area in bytes, 0 if extended state can't be saved.
+ */
+cpu_usize cpu_xstate_alloc_size();
+
+/**
+ * Save the extended (x87, SSE, AVX, ...) state of the current processor.
+ * Uses XSAVES (kernel mode only), XSAVEC, XSAVEOPT, XSAVE or FXSAVE, in that order of preference.
+ * All but XSAVE and FXSAVE skip components in their initial state, XSAVES and XSAVEOPT
+ * additionally skip components not modified since they were restored from the same area.
+ * @param area The save area, cpu_xstate_alloc_size() bytes large, aligned to CPU_XSTATE_ALIGNMENT
+ *  and zeroed before its first use.
+ */
+void cpu_xstate_save(void* area);
+
+/**
+ * Restore the extended state of the current processor saved by cpu_xstate_save().
+ * @param area The save area to restore from.
+ */
+void cpu_xstate_restore(const void* area);
+
+/**
+ * Write back and invalidate every cache line overlapping the given range, e.g. before
+ * handing a buffer to a device which doesn't snoop the caches.
+ * Uses CLFLUSHOPT if available and CLFLUSH otherwise, followed by a fence.
+ * @param address The start of the range.
+ * @param size The size of the range in bytes.
+ */
+void cpu_cache_flush_range(const void* address, cpu_usize size);
+
+/**
+ * Write back every dirty cache line overlapping the given range to memory,
+ * e.g. to persist a log on persistent memory. Lines are only guaranteed to stay cached with CLWB,
+ * which is preferred over CLFLUSHOPT and CLFLUSH.
+ * @param address The start of the range.
+ * @param size The size of the range in bytes.
+ */
+void cpu_cache_writeback_range(const void* address, cpu_usize size);
+
+/**
+ * Write back and invalidate all caches of the current processor using WBINVD.
+ * Stalls for a long time on large caches, prefer the range functions where possible.
+ * @return True if the caches were invalidated, false in usermode.
+ */
+cpu_bool cpu_cache_invalidate_all();
+
+/**
+ * The expected temporal locality of prefetched data, selecting the cache level it is fetched into.
+ */
+typedef enum _CPUPrefetchLocality : cpu_u8 {
+    CPU_PREFETCH_LOCALITY_NONE,  // PREFETCHNTA, minimizes cache pollution
+    CPU_PREFETCH_LOCALITY_LOW,   // PREFETCHT2
+    CPU_PREFETCH_LOCALITY_MEDIUM,// PREFETCHT1
+    CPU_PREFETCH_LOCALITY_HIGH   // PREFETCHT0, into all cache levels
+} CPUPrefetchLocality;
+
+/**
+ * Hint the processor to fetch the cache line holding the given address for reading.
+ * Never faults, even for invalid addresses.
+ * @param address The address to prefetch.
+ * @param locality How long the data is expected to be reused, should be a constant.
+ */
+static inline void cpu_prefetch(const void* address, CPUPrefetchLocality locality) {
+    const char* line = (const char*) address;
+    switch(locality) {
+        case CPU_PREFETCH_LOCALITY_NONE: __asm__ __volatile__("prefetchnta %0" : : "m"(*line)); break;
+        case CPU_PREFETCH_LOCALITY_LOW: __asm__ __volatile__("prefetcht2 %0" : : "m"(*line)); break;
+        case CPU_PREFETCH_LOCALITY_MEDIUM: __asm__ __volatile__("prefetcht1 %0" : : "m"(*line)); break;
+        case CPU_PREFETCH_LOCALITY_HIGH: __asm__ __volatile__("prefetcht0 %0" : : "m"(*line)); break;
+    }
+}
+
+/**
+ * Hint the processor to fetch the cache line holding the given address in exclusive state,
+ * so a following write doesn't need another ownership request.
+ * Executes as a NOP on processors without PREFETCHW.
+ * @param address The address to prefetch.
+ */
+static inline void cpu_prefetchw(const void* address) {
+    __asm__ __volatile__("prefetchw %0" : : "m"(*(const char*) address));
+}
+
+/**
+ * Read the given model specific register of the current processor.
+ * Raises #GP if the MSR isn't implemented, use cpu_msr_probe() for MSRs which may be missing.
+ * Has to be called in kernel mode.
+ */
+cpu_u64 cpu_rdmsr(cpu_u32 msr);
+
+/**
+ * Write the given model specific register of the current processor.
+ * Raises #GP if the MSR isn't implemented or the value is invalid, use cpu_msr_write_safe() otherwise.
+ * Has to be called in kernel mode.
+ */
+void cpu_wrmsr(cpu_u32 msr, cpu_u64 value);
+
+/**
+ * A single read-modify-write of a model specific register, see cpu_msr_apply().
+ */
+typedef struct _CPUMSRWrite {
+    cpu_u32 msr;
+    cpu_u32 : 32;
+    cpu_u64 value;
+    cpu_u64 mask;// Bits taken from value, all other bits are preserved. ~0 writes without reading first
+} CPUMSRWrite;
+
+/**
+ * Read the given model specific register, returning an error instead of faulting
+ * if it isn't implemented. Hypervisors commonly expose different MSRs on different hosts.
+ * The probe is only fault-safe if the #GP handler of the kernel calls cpu_msr_fixup().
+ * @param msr The MSR to read.
+ * @param value Receives the value of the MSR if it is implemented, may be nullptr.
+ * @return True if the MSR could be read, false if it raised #GP or the caller is in usermode.
+ */
+cpu_bool cpu_msr_probe(cpu_u32 msr, cpu_u64* value);
+
+/**
+ * Write the given model specific register, returning an error instead of faulting
+ * if it isn't implemented or the value is rejected.
+ * The write is only fault-safe if the #GP handler of the kernel calls cpu_msr_fixup().
+ * @return True if the value was written, false if it raised #GP or the caller is in usermode.
+ */
+cpu_bool cpu_msr_write_safe(cpu_u32 msr, cpu_u64 value);
+
+/**
+ * Apply a list of MSR writes to the current processor in a single pass, in order.
+ * Writes which wouldn't change the value are skipped, since WRMSR is serializing.
+ * Stops at the first MSR which raises #GP, see cpu_msr_probe().
+ * Has to be called in kernel mode on every processor the writes should apply to.
+ * @param writes The writes to apply.
+ * @param count The number of entries in writes.
+ * @return The number of entries applied, count on success.
+ */
+cpu_usize cpu_msr_apply(const CPUMSRWrite* writes, cpu_usize count);
+
+/**
+ * To be called from the #GP handler of the kernel with the faulting instruction pointer
+ * of the interrupt frame. If the fault was raised by a libcpu MSR probe, the instruction
+ * pointer is redirected to its error path and the handler should return from the exception.
+ * @param instruction_pointer The saved instruction pointer, updated in place.
+ * @return True if the fault was raised by a probe and has been handled.
+ */
+cpu_bool cpu_msr_fixup(cpu_usize* instruction_pointer);
+
+/**
+ * Invalidate the TLB entries of the current processor for the page holding the given address
+ * in the current address space, including global ones, using INVLPG.
+ * Has to be called in kernel mode, like all TLB functions.
+ * @param address An address within the page.
+ */
+void cpu_tlb_flush_page(const void* address);
+
+/**
+ * Invalidate the TLB entries of the current processor for all 4KiB pages overlapping the given range.
+ * Ranges of up to 33 pages are invalidated one page at a time,
+ * larger ones with cpu_tlb_flush_all() or cpu_tlb_flush_all_nonglobal(), since refilling the TLB is cheaper.
+ * @param address The start of the range.
+ * @param size The size of the range in bytes.
+ * @param is_global True if the range may hold global pages, e.g. kernel mappings.
+ */
+void cpu_tlb_flush_range(const void* address, cpu_usize size, cpu_bool is_global);
+
+/**
+ * Invalidate all non-global TLB entries of the given PCID on the current processor.
+ * Uses INVPCID if available. Otherwise the current PCID is flushed by reloading CR3,
+ * and any other PCID by flushing the entire TLB.
+ * @param pcid The process context identifier, PCID is enabled by cpu_init() if supported.
+ */
+void cpu_tlb_flush_pcid(cpu_u16 pcid);
+
+/**
+ * Invalidate all non-global TLB entries of all PCIDs on the current processor,
+ * using INVPCID if available. Equivalent to reloading CR3 while PCID is disabled.
+ */
+void cpu_tlb_flush_all_nonglobal();
+
+/**
+ * Invalidate all TLB entries of the current processor, including global ones.
+ */
+void cpu_tlb_flush_all();
+
+/**
+ * The memory types used by the PAT and MTRRs, with their architectural encodings.
+ */
+typedef enum _CPUMemoryType : cpu_u8 {
+    CPU_MEMORY_TYPE_UC = 0,      // Uncacheable
+    CPU_MEMORY_TYPE_WC = 1,      // Write-combining, for framebuffers and other streaming device memory
+    CPU_MEMORY_TYPE_WT = 4,      // Write-through
+    CPU_MEMORY_TYPE_WP = 5,      // Write-protected
+    CPU_MEMORY_TYPE_WB = 6,      // Write-back
+    CPU_MEMORY_TYPE_UC_MINUS = 7 // Uncacheable, but may be overridden by a WC MTRR. PAT only
+} CPUMemoryType;
+
+/**
+ * Program IA32_PAT of the current processor with the layout
+ * WB, WC, UC-, UC, WB, WP, UC-, WT. The first four entries keep the
+ * meaning of PCD, so only PWT-only mappings change from WT to WC.
+ * Caches and TLBs are flushed, since existing mappings may change their type.
+ * Has to be called in kernel mode with interrupts disabled, on every processor
+ * before any mapping relies on the new layout.
+ * @return True if the PAT was programmed, false if it isn't supported or in usermode.
+ */
+cpu_bool cpu_pat_init();
+
+/**
+ * Retrieve the page table entry bits (PWT, PCD and PAT) selecting the given memory type.
+ * Until cpu_pat_init() was called, the power-on layout is assumed, which lacks WC and WP.
+ * @param type The requested memory type.
+ * @param is_large_page True for 2MiB and 1GiB pages, which hold the PAT bit at bit 12 instead of 7.
+ * @param bits Receives the bits to be or-ed into the page table entry.
+ * @return True if the current layout contains the given memory type.
+ */
+cpu_bool cpu_pat_get_pte_bits(CPUMemoryType type, cpu_bool is_large_page, cpu_u64* bits);
+
+/**
+ * A variable range MTRR. Every address for which (address & mask) == (base & mask) holds
+ * is covered, which is a single contiguous range of size bytes for all sane configurations.
+ */
+typedef struct _CPUMTRRRange {
+    cpu_u64 base;
+    cpu_u64 mask;
+    cpu_u64 size;
+    CPUMemoryType type;
+} CPUMTRRRange;
+
+/**
+ * The MTRR configuration of the current processor, from IA32_MTRRCAP and IA32_MTRR_DEF_TYPE.
+ */
+typedef struct _CPUMTRRInfo {
+    cpu_bool is_enabled;// If not set, all physical memory is UC
+    cpu_bool has_fixed; // Fixed ranges for the first MiB are supported
+    cpu_bool is_fixed_enabled;
+    cpu_bool has_wc;           // WC may be used as an MTRR type
+    CPUMemoryType default_type;// Of memory not covered by any range
+    cpu_u8 num_variable;       // Variable ranges supported, including disabled ones
+} CPUMTRRInfo;
+
+/**
+ * Retrieve the MTRR configuration of the current processor.
+ * @param info Receives the configuration.
+ * @return True if MTRRs are supported and could be read, false otherwise or in usermode.
+ */
+cpu_bool cpu_mtrr_get_info(CPUMTRRInfo* info);
+
+/**
+ * Enumerate the enabled variable range MTRRs of the current processor.
+ * Has to be called in kernel mode.
+ * @param ranges Receives up to max_ranges ranges, may be nullptr to only count them.
+ * @param max_ranges The capacity of ranges.
+ * @return The number of enabled variable ranges.
+ */
+cpu_usize cpu_mtrr_get_ranges(CPUMTRRRange* ranges, cpu_usize max_ranges);
+
+/**
+ * Find an enabled variable range MTRR overlapping the given physical range with a type other than
+ * the given one, e.g. a WB range covering a device window which should be mapped WC.
+ * Has to be called in kernel mode.
+ * @param base The physical start address of the range.
+ * @param size The size of the range in bytes.
+ * @param type The memory type the range is going to be mapped with.
+ * @param conflict Receives the first conflicting range, may be nullptr.
+ * @return True if a conflicting range exists.
+ */
+cpu_bool cpu_mtrr_find_conflict(cpu_u64 base, cpu_u64 size, CPUMemoryType type, CPUMTRRRange* conflict);
+
+/**
+ * The architectural performance events, as bit indices into CPUPMUInfo.events.
+ */
+typedef enum _CPUPMUEvent : cpu_u8 {
+    CPU_PMU_EVENT_CORE_CYCLES,
+    CPU_PMU_EVENT_INSTRUCTIONS_RETIRED,
+    CPU_PMU_EVENT_REFERENCE_CYCLES,
+    CPU_PMU_EVENT_LLC_REFERENCES,
+    CPU_PMU_EVENT_LLC_MISSES,
+    CPU_PMU_EVENT_BRANCHES_RETIRED,
+    CPU_PMU_EVENT_BRANCH_MISPREDICTS,
+    CPU_PMU_EVENT_COUNT
+} CPUPMUEvent;
+
+/**
+ * The privilege levels a counter counts in, combined with bitwise or.
+ * Configuring a counter with CPU_PMU_COUNT_NONE stops it.
+ */
+typedef enum _CPUPMUCount : cpu_u8 {
+    CPU_PMU_COUNT_NONE = 0,
+    CPU_PMU_COUNT_USER = 1 << 0,
+    CPU_PMU_COUNT_KERNEL = 1 << 1,
+    CPU_PMU_COUNT_ALL = CPU_PMU_COUNT_USER | CPU_PMU_COUNT_KERNEL
+} CPUPMUCount;
+
+/**
+ * The performance monitoring unit of the current processor, decoded from CPUID leaf 0xA
+ * on Intel and leaves 0x80000001/0x80000022 on AMD.
+ */
+typedef struct _CPUPMUInfo {
+    cpu_u8 version;           // Intel architectural performance monitoring version, 0 on AMD
+    cpu_u8 num_counters;      // General purpose counters
+    cpu_u8 counter_width;     // In bits
+    cpu_u8 num_fixed_counters;// Intel only, instructions, core cycles and reference cycles in that order
+    cpu_u8 fixed_counter_width;
+    cpu_bool has_global_ctrl;// Counters also have to be enabled through a global control MSR
+    cpu_u16 events;          // Supported CPUPMUEvent values, as a bit mask
+} CPUPMUInfo;
+
+/**
+ * Select a fixed counter for cpu_pmu_read().
+ */
+#define CPU_PMU_FIXED_COUNTER(n) ((1U << 30) | (n))
+
+/**
+ * @return The performance monitoring unit of the current processor.
+ */
+CPUPMUInfo cpu_pmu_get_info();
+
+/**
+ * Program the given general purpose counter to count an architectural event and reset it to 0.
+ * Also sets CR4.PCE, so cpu_pmu_read() may be used from usermode.
+ * Has to be called in kernel mode on every processor the counter should run on.
+ * @param counter The index of the counter, below CPUPMUInfo.num_counters.
+ * @param event The event to count, has to be contained in CPUPMUInfo.events.
+ * @param count The privilege levels to count in.
+ * @return True if the counter was programmed, false if it or the event isn't available or in usermode.
+ */
+cpu_bool cpu_pmu_configure(cpu_u32 counter, CPUPMUEvent event, CPUPMUCount count);
+
+/**
+ * Like cpu_pmu_configure(), but with a model specific event select and unit mask.
+ * @param event The event select, bits 11:8 are only used on AMD.
+ */
+cpu_bool cpu_pmu_configure_raw(cpu_u32 counter, cpu_u16 event, cpu_u8 unit_mask, CPUPMUCount count);
+
+/**
+ * Enable or disable the given fixed counter and reset it to 0. Intel only.
+ * @param counter The index of the counter, below CPUPMUInfo.num_fixed_counters.
+ * @param count The privilege levels to count in.
+ * @return True if the counter was programmed, false if it isn't available or in usermode.
+ */
+cpu_bool cpu_pmu_configure_fixed(cpu_u32 counter, CPUPMUCount count);
+
+/**
+ * Read the given performance counter using a single RDPMC.
+ * Only usable from usermode once a counter was configured on the current processor.
+ * @param counter The index of a general purpose counter, or CPU_PMU_FIXED_COUNTER(n).
+ * @return The current value of the counter, counter_width bits wide.
+ */
+static inline cpu_u64 cpu_pmu_read(cpu_u32 counter) {
+    cpu_u32 low;
+    cpu_u32 high;
+    __asm__ __volatile__("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return ((cpu_u64) high << 32) | low;
+}
+
+/**
+ * The power management capabilities of the current processor, decoded from CPUID leaf 6.
+ */
+typedef struct _CPUPowerCaps {
+    cpu_bool has_turbo;              // Intel Turbo Boost or AMD Core Performance Boost, even if disabled
+    cpu_bool has_arat;               // The APIC timer keeps running in deep C-states
+    cpu_bool has_hwp;                // Hardware controlled performance states
+    cpu_bool has_hwp_epp;            // HWP energy/performance preference
+    cpu_bool has_hwp_package_request;// Package level HWP requests
+    cpu_bool has_aperf_mperf;        // Effective frequency counters
+    cpu_bool has_energy_perf_bias;
+    // Performance levels from IA32_HWP_CAPABILITIES, all zero without HWP or in usermode
+    cpu_u8 highest_perf;
+    cpu_u8 guaranteed_perf;
+    cpu_u8 efficient_perf;
+    cpu_u8 lowest_perf;
+} CPUPowerCaps;
+
+/**
+ * @return The power management capabilities of the current processor.
+ *  Turbo disabled by firmware is only detected in kernel mode on Intel, through IA32_MISC_ENABLE.
+ */
+CPUPowerCaps cpu_get_power_caps();
+
+/**
+ * Enable HWP through IA32_PM_ENABLE if required and constrain the performance
+ * levels the current processor selects autonomously through IA32_HWP_REQUEST.
+ * Latency critical cores should use a high minimum and an EPP of 0,
+ * background cores a low maximum and a high EPP.
+ * Has to be called in kernel mode on every processor.
+ * @param min_perf The minimum performance level, see CPUPowerCaps.lowest_perf.
+ * @param max_perf The maximum performance level, see CPUPowerCaps.highest_perf.
+ * @param epp The energy/performance preference, 0 for performance up to 255 for energy efficiency.
+ *  Applied through IA32_ENERGY_PERF_BIAS if HWP doesn't support EPP.
+ * @return True if the preference was applied, false without HWP, in usermode or if min_perf > max_perf.
+ */
+cpu_bool cpu_set_perf_preference(cpu_u8 min_perf, cpu_u8 max_perf, cpu_u8 epp);
+
+/**
+ * Enable or disable Intel Turbo Boost or AMD Core Performance Boost on the current processor.
+ * @param is_enabled True to allow frequencies above the base frequency.
+ * @return True if the setting was applied, false if turbo isn't supported or in usermode.
+ */
+cpu_bool cpu_set_turbo(cpu_bool is_enabled);
+
+/**
+ * @return The performance level currently granted to the current processor
+ *  from IA32_PERF_STATUS, or 0 if it isn't available (non-Intel processors or usermode).
+ */
+cpu_u8 cpu_get_current_perf();
+
+/**
+ * The paravirtual features reported by KVM in EAX of CPUID leaf 0x40000001, as bit indices.
+ */
+typedef enum _CPUKVMFeature : cpu_u8 {
+    CPU_KVM_FEATURE_CLOCKSOURCE = 0,
+    CPU_KVM_FEATURE_NOP_IO_DELAY = 1,
+    CPU_KVM_FEATURE_CLOCKSOURCE2 = 3,
+    CPU_KVM_FEATURE_ASYNC_PF = 4,
+    CPU_KVM_FEATURE_STEAL_TIME = 5,
+    CPU_KVM_FEATURE_PV_EOI = 6,
+    CPU_KVM_FEATURE_PV_UNHALT = 7,
+    CPU_KVM_FEATURE_PV_TLB_FLUSH = 9,
+    CPU_KVM_FEATURE_PV_SEND_IPI = 11,
+    CPU_KVM_FEATURE_POLL_CONTROL = 12,
+    CPU_KVM_FEATURE_PV_SCHED_YIELD = 13,
+    CPU_KVM_FEATURE_CLOCKSOURCE_STABLE = 24// The TSC stable flag of the pvclock is valid
+} CPUKVMFeature;
+
+/**
+ * The pvclock structure shared with KVM, one per vCPU.
+ * Must be 32-byte aligned so it doesn't cross a page boundary.
+ */
+typedef struct _CPUKVMPVClock {
+    alignas(32) volatile cpu_u32 version;// Odd while the host is updating the structure
+    cpu_u32 : 32;
+    volatile cpu_u64 tsc_timestamp;
+    volatile cpu_u64 system_time;// Nanoseconds at tsc_timestamp
+    volatile cpu_u32 tsc_to_system_mul;
+    volatile cpu_i8 tsc_shift;
+    volatile cpu_u8 flags;// Bit 0 is set if the clock is stable across vCPUs
+    cpu_u16 : 16;
+} CPUKVMPVClock;
+
+/**
+ * The steal time structure shared with KVM, one per vCPU, 64-byte aligned.
+ */
+typedef struct _CPUKVMStealTime {
+    alignas(64) volatile cpu_u64 steal;// Nanoseconds the vCPU was runnable but not running
+    volatile cpu_u32 version;
+    volatile cpu_u32 flags;
+    volatile cpu_u8 preempted;
+    cpu_u8 padding[47];
+} CPUKVMStealTime;
+
+/**
+ * @param feature The paravirtual feature to test for.
+ * @return True if running under KVM and the given feature is reported.
+ */
+cpu_bool cpu_kvm_has_feature(CPUKVMFeature feature);
+
+/**
+ * Register the pvclock structure of the current vCPU with KVM,
+ * using the CLOCKSOURCE2 MSR if available. Has to be called in kernel mode on every vCPU.
+ * @param physical_address The guest physical address of the CPUKVMPVClock structure.
+ * @return True if the structure was registered.
+ */
+cpu_bool cpu_kvm_pvclock_init(cpu_u64 physical_address);
+
+/**
+ * Read the guest time from a registered pvclock structure.
+ * Unlike the raw TSC, this stays consistent across migrations and TSC frequency changes.
+ * Reads the structure of the current vCPU, unless the stable flag is set.
+ * @param clock The pvclock structure to read.
+ * @return The guest time in nanoseconds.
+ */
+cpu_u64 cpu_kvm_pvclock_read(const CPUKVMPVClock* clock);
+
+/**
+ * Register the steal time structure of the current vCPU with KVM.
+ * Has to be called in kernel mode on every vCPU.
+ * @param physical_address The guest physical address of the CPUKVMStealTime structure.
+ * @return True if the structure was registered.
+ */
+cpu_bool cpu_kvm_steal_time_init(cpu_u64 physical_address);
+
+/**
+ * @param steal_time A registered steal time structure.
+ * @return The total time in nanoseconds the owning vCPU was preempted by the host.
+ */
+cpu_u64 cpu_kvm_steal_time_read(const CPUKVMStealTime* steal_time);
+
+/**
+ * Determine whether the vCPU owning the given steal time structure is currently preempted,
+ * so a lock waiter can stop spinning on a holder which can't make progress.
+ * @param steal_time A registered steal time structure.
+ * @return True if the owning vCPU is preempted.
+ */
+cpu_bool cpu_kvm_is_preempted(const CPUKVMStealTime* steal_time);
+
+/**
+ * A drop-in replacement for cpu_hint_spin() in loops waiting for the given value to change.
+ * Halts the vCPU until it is kicked by cpu_kvm_kick() if KVM reports PV_UNHALT,
+ * giving its timeslice back to the host instead of burning it, and spins otherwise.
+ * Returns spuriously, so it has to be called in a loop re-checking the condition.
+ * @param address The address of the value waited on.
+ * @param expected The value to halt on, returns immediately if the value differs.
+ */
+void cpu_kvm_wait(const volatile cpu_u32* address, cpu_u32 expected);
+
+/**
+ * Wake a vCPU halted in cpu_kvm_wait() using the KVM_HC_KICK_CPU hypercall.
+ * Does nothing without PV_UNHALT or in usermode.
+ * @param apic_id The APIC ID of the vCPU to wake.
+ */
+void cpu_kvm_kick(cpu_u32 apic_id);
+
+#ifdef CPU_64_BIT
+
+/**
+ * The start of every per-CPU block, maintained by libcpu.
+ * Embed this as the first member of your per-CPU structure.
+ */
+typedef struct _CPUPerCPUHeader {
+    void* self;// Address of the block, so it can be obtained with a single GS-relative load
+    cpu_usize size;
+    cpu_u32 id;// APIC ID of the owning processor
+    cpu_u32 : 32;
+} CPUPerCPUHeader;
+
+/**
+ * Install the given block as the per-CPU data of the current processor.
+ * The block is addressed through the GS base, which is set using WRGSBASE
+ * if CR4.FSGSBASE is enabled and through the IA32_GS_BASE MSR otherwise.
+ * Also stores the tagged APIC ID in TSC_AUX for cpu_current_id() if RDTSCP or RDPID is available,
+ * which replaces any value the OS keeps there for RDTSCP.
+ * Has to be called in kernel mode, once on every processor.
+ * @param base The per-CPU block of the current processor, starting with a CPUPerCPUHeader.
+ * @param size The size of the block in bytes.
+ * @return True if the block was installed, false if it is too small or the caller is in usermode.
+ */
+cpu_bool cpu_percpu_init(void* base, cpu_usize size);
+
+// clang-format off
+#define LCPU_DEFINE_PERCPU(s, t, suffix, out, in)                                                      \
+    static inline t cpu_percpu_read##s(cpu_usize offset) {                                             \
+        t value;                                                                                       \
+        __asm__ __volatile__("mov" suffix " %%gs:%1, %0" : "=" out(value) : "m"(*(const t*) offset));  \
+        return value;                                                                                  \
+    }                                                                                                  \
+    static inline void cpu_percpu_write##s(cpu_usize offset, t value) {                                \
+        __asm__ __volatile__("mov" suffix " %1, %%gs:%0" : "=m"(*(t*) offset) : in(value));            \
+    }
+// clang-format on
+
+/**
+ * Read or write a value at the given offset into the per-CPU block of the current processor,
+ * e.g. cpu_percpu_read32(offsetof(MyPerCPU, counter)). Each access is a single GS-relative MOV.
+ */
+LCPU_DEFINE_PERCPU(8, cpu_u8, "b", "q", "qi")
+LCPU_DEFINE_PERCPU(16, cpu_u16, "w", "r", "ri")
+LCPU_DEFINE_PERCPU(32, cpu_u32, "l", "r", "ri")
+LCPU_DEFINE_PERCPU(64, cpu_u64, "q", "r", "er")
+
+#undef LCPU_DEFINE_PERCPU
+
+/**
+ * @return The per-CPU block of the current processor, as passed to cpu_percpu_init().
+ */
+static inline void* cpu_percpu_get_base() {
+    return (void*) cpu_percpu_read64(0);// CPUPerCPUHeader.self
+}
+
+#endif// CPU_64_BIT
+
+LCPU_API_END
+
+#endif// CPU_X86
@@ -0,0 +1,282 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define CACHE_DEFAULT_LINE_SIZE 64
+
+// clang-format off
+#define DEFINE_CACHE_LINE_OP(n)                         \
+    static void n(const void* address) {                \
+        _assemble(                                      \
+            _ins(_in(address)),                         \
+            _outs(),                                    \
+            _clobs(_clob(memory)),                      \
+            _emitI(n _get(_var(address)))               \
+        );                                              \
+    }
+// clang-format on
+
+DEFINE_CACHE_LINE_OP(clflush)
+DEFINE_CACHE_LINE_OP(clflushopt)
+DEFINE_CACHE_LINE_OP(clwb)
+
+static void mfence() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(mfence));
+}
+
+static void sfence() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(sfence));
+}
+
+static void wbinvd() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(wbinvd));
+}
+
+static cpu_bool decode_cache_type(cpu_u32 value, CPUCacheType* type) {
+    switch(value) {
+        case 1: *type = CPU_CACHE_TYPE_DATA; return LCPU_TRUE;
+        case 2: *type = CPU_CACHE_TYPE_INSTRUCTION; return LCPU_TRUE;
+        case 3: *type = CPU_CACHE_TYPE_UNIFIED; return LCPU_TRUE;
+        default: return LCPU_FALSE;
+    }
+}
+
+// Associativity encoding of the L2/L3 descriptors in leaf 80000006
+static cpu_u32 decode_legacy_associativity(cpu_u32 value, cpu_u32 num_lines) {
+    switch(value) {// clang-format off
+        case 0x1: return 1;
+        case 0x2: return 2;
+        case 0x3: return 3;
+        case 0x4: return 4;
+        case 0x5: return 6;
+        case 0x6: return 8;
+        case 0x8: return 16;
+        case 0xA: return 32;
+        case 0xB: return 48;
+        case 0xC: return 64;
+        case 0xD: return 96;
+        case 0xE: return 128;
+        case 0xF: return num_lines;
+        default:  return 0;// Disabled or reserved
+    }// clang-format on
+}
+
+// Associativity of the L1 descriptors in leaf 80000005
+static cpu_u32 decode_l1_associativity(CPUID_ECX_L80000005 descriptor) {
+    if(descriptor.associativity == 0xFF && descriptor.line_size != 0) {
+        return ((cpu_u32) descriptor.size << 10) / descriptor.line_size;
+    }
+    return descriptor.associativity;
+}
+
+// Enumerates leaf 4 or leaf 8000001D, which share the same layout
+static void enumerate_deterministic(CPUCacheInfo* cache_info, cpu_u32 leaf) {
+    for(cpu_u32 sub_leaf = 0; cache_info->num_caches < CPU_MAX_CACHES; ++sub_leaf) {
+        CPUID value;
+        lcpu_cpuid(leaf, sub_leaf, &value);
+        const CPUID_EAX_L4 eax = value.eax.leaf4;
+        const CPUID_EBX_L4 ebx = value.ebx.leaf4;
+        CPUCacheType type;
+        if(!decode_cache_type(eax.type, &type)) {
+            break;// Type 0 terminates the list
+        }
+        CPUCache* cache = &cache_info->caches[cache_info->num_caches++];
+        cache->type = type;
+        cache->level = eax.level;
+        cache->line_size = ebx.line_size + 1;
+        cache->associativity = ebx.ways + 1;
+        cache->num_sets = value.ecx.value + 1;
+        cache->size = (cpu_usize) cache->line_size * (ebx.partitions + 1) * cache->associativity * cache->num_sets;
+        cache->num_sharing = eax.max_sharing_ids + 1;
+        cache->is_inclusive = value.edx.leaf4.inclusive;
+        cache->is_fully_associative = eax.fully_associative;
+    }
+}
+
+static void add_legacy_cache(CPUCacheInfo* cache_info, CPUCacheType type, cpu_u32 level, cpu_usize size,
+                             cpu_u32 line_size, cpu_u32 associativity, cpu_u32 num_sharing) {
+    if(size == 0 || line_size == 0 || associativity == 0 || cache_info->num_caches >= CPU_MAX_CACHES) {
+        return;// Not present or disabled
+    }
+    CPUCache* cache = &cache_info->caches[cache_info->num_caches++];
+    const cpu_u32 num_lines = (cpu_u32) (size / line_size);
+    cache->type = type;
+    cache->level = level;
+    cache->size = size;
+    cache->line_size = line_size;
+    cache->associativity = associativity;
+    cache->num_sets = num_lines / associativity;
+    cache->num_sharing = num_sharing;
+    cache->is_inclusive = LCPU_FALSE;
+    cache->is_fully_associative = associativity == num_lines;
+}
+
+// Leaves 80000005/80000006 only describe a single core, except for the L3 cache
+static void enumerate_legacy(CPUCacheInfo* cache_info) {
+    CPUID value;
+    lcpu_cpuid(1, 0, &value);
+    const cpu_u32 num_logical = value.edx.leaf1.htt ? value.ebx.leaf1.max_logical_ids : 1;
+
+    lcpu_cpuid(0x80000005, 0, &value);
+    const CPUID_ECX_L80000005 l1d = value.ecx.leaf80000005;
+    const CPUID_EDX_L80000005 l1i = value.edx.leaf80000005;
+    add_legacy_cache(cache_info, CPU_CACHE_TYPE_DATA, 1, (cpu_usize) l1d.size << 10, l1d.line_size,
+                     decode_l1_associativity(l1d), 1);
+    add_legacy_cache(cache_info, CPU_CACHE_TYPE_INSTRUCTION, 1, (cpu_usize) l1i.size << 10, l1i.line_size,
+                     decode_l1_associativity(l1i), 1);
+
+    lcpu_cpuid(0x80000006, 0, &value);
+    const CPUID_ECX_L80000006 l2 = value.ecx.leaf80000006;
+    const CPUID_EDX_L80000006 l3 = value.edx.leaf80000006;
+    if(l2.line_size != 0) {
+        const cpu_usize size = (cpu_usize) l2.size << 10;
+        add_legacy_cache(cache_info, CPU_CACHE_TYPE_UNIFIED, 2, size, l2.line_size,
+                         decode_legacy_associativity(l2.associativity, (cpu_u32) (size / l2.line_size)), 1);
+    }
+    if(l3.line_size != 0) {
+        const cpu_usize size = (cpu_usize) l3.size << 19;
+        add_legacy_cache(cache_info, CPU_CACHE_TYPE_UNIFIED, 3, size, l3.line_size,
+                         decode_legacy_associativity(l3.associativity, (cpu_u32) (size / l3.line_size)),
+                         num_logical);
+    }
+}
+
+const CPUCacheInfo* cpu_get_cache_info() {
+    CPUInfo* info = lcpu_get_info();
+    if(cpu_atomic_load8(&info->is_cache_info_valid, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return &info->cache_info;
+    }
+    // Decode into a local copy, so concurrent callers never observe a partially written table
+    CPUCacheInfo decoded = {0};
+    CPUCacheInfo* cache_info = &decoded;
+    // TOPOEXT is only reported by AMD, which leaves leaf 4 reserved
+    if(cpu_feature_set_test(&info->features, CPU_FEATURE_TOPOEXT)) {
+        enumerate_deterministic(cache_info, 0x8000001D);
+    }
+    if(cache_info->num_caches == 0) {
+        enumerate_deterministic(cache_info, 4);
+    }
+    if(cache_info->num_caches == 0) {
+        enumerate_legacy(cache_info);
+    }
+    lcpu_decode_lock();
+    if(!info->is_cache_info_valid) {
+        info->cache_info = decoded;
+        cpu_atomic_store8(&info->is_cache_info_valid, LCPU_TRUE, CPU_MEMORY_ORDER_RELEASE);
+    }
+    lcpu_decode_unlock();
+    return &info->cache_info;
+}
+
+const CPUCache* cpu_get_cache(cpu_u32 level, CPUCacheType type) {
+    const CPUCacheInfo* cache_info = cpu_get_cache_info();
+    for(cpu_usize index = 0; index < cache_info->num_caches; ++index) {
+        const CPUCache* cache = &cache_info->caches[index];
+        if(cache->level != level) {
+            continue;
+        }
+        if(cache->type == type || cache->type == CPU_CACHE_TYPE_UNIFIED) {
+            return cache;
+        }
+    }
+    return nullptr;
+}
+
+cpu_usize cpu_get_cacheline_size() {
+    const CPUCache* cache = cpu_get_cache(1, CPU_CACHE_TYPE_DATA);
+    if(cache != nullptr) {
+        return cache->line_size;
+    }
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_CLFSH)) {
+        CPUID value;
+        lcpu_cpuid(1, 0, &value);
+        return (cpu_usize) value.ebx.leaf1.clflush_size << 3;
+    }
+    return CACHE_DEFAULT_LINE_SIZE;
+}
+
+// CLFLUSH and friends operate on the line size reported in leaf 1, which may differ from the L1 line size
+static cpu_usize get_flush_line_size() {
+    CPUID value;
+    lcpu_cpuid(1, 0, &value);
+    const cpu_usize size = (cpu_usize) value.ebx.leaf1.clflush_size << 3;
+    return size != 0 ? size : CACHE_DEFAULT_LINE_SIZE;
+}
+
+static void for_each_line(const void* address, cpu_usize size, void (*op)(const void*)) {
+    if(size == 0) {
+        return;
+    }
+    const cpu_usize line_size = get_flush_line_size();
+    const cpu_usize end = (cpu_usize) address + size;
+    for(cpu_usize line = (cpu_usize) address & ~(line_size - 1); line < end; line += line_size) {
+        op((const void*) line);
+    }
+}
+
+void cpu_cache_flush_range(const void* address, cpu_usize size) {
+    const CPUFeatureSet* features = &lcpu_get_info()->features;
+    // CLFLUSHOPT is only ordered with older stores to the same line, so the fence completes the whole range
+    if(cpu_feature_set_test(features, CPU_FEATURE_CLFLUSHOPT)) {
+        for_each_line(address, size, clflushopt);
+        sfence();
+        return;
+    }
+    if(cpu_feature_set_test(features, CPU_FEATURE_CLFSH)) {
+        for_each_line(address, size, clflush);
+        mfence();
+    }
+}
+
+void cpu_cache_writeback_range(const void* address, cpu_usize size) {
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_CLWB)) {
+        for_each_line(address, size, clwb);
+        sfence();
+        return;
+    }
+    cpu_cache_flush_range(address, size);
+}
+
+cpu_bool cpu_cache_invalidate_all() {
+    if(cpu_is_usermode()) {
+        return LCPU_FALSE;
+    }
+    wbinvd();
+    return LCPU_TRUE;
+}
+
+cpu_usize lcpu_get_shared_cache_size() {
+    const CPUCacheInfo* cache_info = cpu_get_cache_info();
+    cpu_usize size = 0;
+    for(cpu_usize index = 0; index < cache_info->num_caches; ++index) {
+        const CPUCache* cache = &cache_info->caches[index];
+        if(cache->type != CPU_CACHE_TYPE_INSTRUCTION && cache->size > size) {
+            size = cache->size;
+        }
+    }
+    return size;
+}
+
+#endif// CPU_X86
@@ -19,15 +19,17 @@
 #ifdef CPU_RISCV
 
 #include "cpu/cpu.h"
+#include "popcnt.h"
 
 // NOLINTBEGIN
 // clang-format off
 static CPUFeature g_available_features[] = {
 };
 // clang-format on
-static CPUFeature g_enabled_features = CPU_FEATURE_NONE;
+static CPUFeatureSet g_enabled_features = {0};
 static cpu_bool g_is_initialized = LCPU_FALSE;
 static cpu_bool g_is_usermode = LCPU_FALSE;
+static CPUCacheInfo g_cache_info = {0};
 // NOLINTEND
 
 cpu_usize cpu_get_gpr_width() {
@@ -50,12 +52,12 @@ const char* cpu_vendor_get_name(CPUVendor vendor) {
     return "Unknown";
 }
 
-CPUFeature cpu_get_features() {
-    return CPU_FEATURE_NONE;
+CPUFeatureSet cpu_get_features() {
+    return (CPUFeatureSet){0};
 }
 
-CPUFeature cpu_get_enabled_features() {
-    return CPU_FEATURE_NONE;
+CPUFeatureSet cpu_get_enabled_features() {
+    return g_enabled_features;
 }
 
 const CPUFeature* cpu_get_available_features() {
@@ -70,11 +72,34 @@ const char* cpu_feature_get_name(CPUFeature feature) {
     return "Unknown";
 }
 
+const CPUCacheInfo* cpu_get_cache_info() {
+    return &g_cache_info;// The hierarchy isn't enumerated on this port
+}
+
+const CPUCache* cpu_get_cache(cpu_u32 level, CPUCacheType type) {
+    (void) level;
+    (void) type;
+    return nullptr;
+}
+
+cpu_usize cpu_get_cacheline_size() {
+    return 64;
+}
+
+cpu_u32 cpu_get_apic_id() {
+    return 0;
+}
+
+CPUTopology cpu_get_topology(cpu_u32 apic_id) {
+    // Every processor is reported as its own single-threaded package
+    return (CPUTopology){apic_id, 0, 0, 0, 0, 0, 1, 1, 1, 1};
+}
+
 void cpu_reset_state() {
     g_is_initialized = LCPU_FALSE;
 }
 
-void cpu_init(CPUFeature features) {
+void cpu_init(CPUFeatureSet features) {
     if(g_is_initialized) {
         return;
     }
@@ -82,6 +107,10 @@ void cpu_init(CPUFeature features) {
     g_is_initialized = LCPU_TRUE;
 }
 
+cpu_bool cpu_init_ap() {
+    return g_is_initialized;// No per-core state is kept on this port, so there is nothing to replay
+}
+
 cpu_bool cpu_is_initialized() {
     return g_is_initialized;
 }
@@ -99,7 +128,25 @@ void cpu_hint_spin() {
 }
 
 _Noreturn void cpu_halt() {
-    // TODO: implement this
+    if(g_is_usermode) {
+        while(true) {
+            cpu_hint_spin();
+        }
+    }
+    __asm__ __volatile__("csrci sstatus, 2");// Clear SIE, pending interrupts still end WFI
+    while(true) {
+        __asm__ __volatile__("wfi");
+    }
+}
+
+void cpu_idle(CPUIdleHint hint) {
+    (void) hint;// WFI doesn't distinguish between low power states
+    if(g_is_usermode) {
+        cpu_hint_spin();
+        return;
+    }
+    // WFI resumes on pending interrupts regardless of SIE, which are taken once it is set
+    __asm__ __volatile__("wfi; csrsi sstatus, 2" : : : "memory");
 }
 
 void cpu_enter_usermode() {
@@ -111,30 +158,53 @@ cpu_bool cpu_is_usermode() {
 }
 
 cpu_usize cpu_popcnt16(cpu_u16 value) {
-    cpu_usize count = 0;
-    while(value != 0) {
-        value &= (value - 1);
-        ++count;
-    }
-    return count;
+    return popcnt32_impl((cpu_u32) value);
 }
 
 cpu_usize cpu_popcnt32(cpu_u32 value) {
-    cpu_usize count = 0;
-    while(value != 0) {
-        value &= (value - 1);
-        ++count;
-    }
-    return count;
+    return popcnt32_impl(value);
 }
 
 cpu_usize cpu_popcnt64(cpu_u64 value) {
-    cpu_usize count = 0;
-    while(value != 0) {
-        value &= (value - 1);
-        ++count;
+    return popcnt64_impl(value);
+}
+
+cpu_u64 cpu_popcnt_buffer(const void* data, cpu_usize size) {
+    return popcnt_buffer_impl((const cpu_u8*) data, nullptr, size);
+}
+
+cpu_u64 cpu_popcnt_buffer_and(const void* data, const void* mask, cpu_usize size) {
+    return popcnt_buffer_impl((const cpu_u8*) data, (const cpu_u8*) mask, size);
+}
+
+void* cpu_memcpy(void* dst, const void* src, cpu_usize size) {
+    cpu_u8* dst_ptr = (cpu_u8*) dst;
+    const cpu_u8* src_ptr = (const cpu_u8*) src;
+    for(cpu_usize index = 0; index < size; ++index) {
+        dst_ptr[index] = src_ptr[index];
+    }
+    return dst;
+}
+
+void* cpu_memmove(void* dst, const void* src, cpu_usize size) {
+    cpu_u8* dst_ptr = (cpu_u8*) dst;
+    const cpu_u8* src_ptr = (const cpu_u8*) src;
+    if(dst_ptr <= src_ptr) {
+        return cpu_memcpy(dst, src, size);
+    }
+    while(size > 0) {
+        --size;
+        dst_ptr[size] = src_ptr[size];
+    }
+    return dst;
+}
+
+void* cpu_memset(void* dst, cpu_u8 value, cpu_usize size) {
+    cpu_u8* dst_ptr = (cpu_u8*) dst;
+    for(cpu_usize index = 0; index < size; ++index) {
+        dst_ptr[index] = value;
     }
-    return count;
+    return dst;
 }
 
 #endif
\ No newline at end of file
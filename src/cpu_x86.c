@@ -21,7 +21,11 @@
 #include "cpu_x86.h"
 #include "assembler.h"
 #include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu/cpu_x86.h"
 #include "memory.h"
+#include "popcnt.h"
+#include "stats.h"
 #include "utils.h"
 
 // clang-format off
@@ -30,7 +34,7 @@
         _assemble(                                   \
             _ins(),                                  \
             _outs(_inout(value)),                    \
-            _clobs(_sclob(ax)),                      \
+            _clobs(_sclob(ax), _clob(memory)),       \
             _emitI(mov _reg(r), _sreg(ax))           \
             _emitI(mov _sreg(ax), _get(_var(value))) \
         );                                           \
@@ -48,11 +52,44 @@
     }
 // clang-format on
 
+#define INFO_STATE_INVALID 0
+#define INFO_STATE_ENUMERATING 1
+#define INFO_STATE_VALID 2
+
+#define XCR0_AVX512_MASK 0xE0// Opmask, ZMM_Hi256 and Hi16_ZMM
+
+#define CORE_TABLE_SIZE 1024// Power of two
+#define CORE_KEY_EMPTY 0    // Keys are APIC ID + 1
+
+// State of a single processor, as the control registers are per-core
+typedef struct _CoreState {
+    volatile cpu_u32 key;
+    volatile cpu_bool is_initialized;
+    volatile cpu_bool is_usermode;
+} CoreState;
+
+// Compared as three 32-bit words instead of byte by byte
+typedef struct _VendorSignature {
+    union {
+        char chars[16];// 12 characters, zero padded
+        cpu_u32 words[4];
+    };
+    CPUVendor vendor;
+} VendorSignature;
+
 // NOLINTBEGIN
-static cpu_bool g_is_initialized = LCPU_FALSE;
+static cpu_bool g_is_initialized = LCPU_FALSE;// The feature configuration was chosen
 static CPUExceptionHandler g_exception_handler = nullptr;
-static CPUFeature g_enabled_features = CPU_FEATURE_NONE;
-static cpu_bool g_is_usermode = LCPU_FALSE;
+static CPUFeatureSet g_enabled_features = {0};
+static CPUTicketLock g_init_lock = CPU_TICKET_LOCK_INIT;
+static CoreState g_cores[CORE_TABLE_SIZE];
+static CoreState g_overflow_core;// Shared by all processors not fitting into the table
+static volatile cpu_u32 g_num_cores = 0;         // Processors which claimed a table slot
+static volatile cpu_u32 g_num_usermode_cores = 0;// Processors which entered usermode
+static volatile cpu_u32 g_info_state = INFO_STATE_INVALID;
+static CPUTicketLock g_cpuid_lock = CPU_TICKET_LOCK_INIT;
+static CPUTicketLock g_decode_lock = CPU_TICKET_LOCK_INIT;
+static CPUInfo g_info;
 // clang-format off
 static CPUFeature g_available_features[] = {
         CPU_FEATURE_X87,
@@ -71,30 +108,214 @@ static CPUFeature g_available_features[] = {
         CPU_FEATURE_FMA4,
         CPU_FEATURE_FXSR,
         CPU_FEATURE_XSAVE,
+        CPU_FEATURE_NX,
+        CPU_FEATURE_RDRND,
+        CPU_FEATURE_RDSEED,
+        CPU_FEATURE_RDTSC,
         CPU_FEATURE_CX8,
         CPU_FEATURE_CX16,
         CPU_FEATURE_MONITOR,
         CPU_FEATURE_POPCNT,
-        CPU_FEATURE_NX,
-        CPU_FEATURE_RDRND,
-        CPU_FEATURE_RDSEED,
-        CPU_FEATURE_RDTSC
+        CPU_FEATURE_PSE,
+        CPU_FEATURE_MSR,
+        CPU_FEATURE_PAE,
+        CPU_FEATURE_APIC,
+        CPU_FEATURE_SEP,
+        CPU_FEATURE_MTRR,
+        CPU_FEATURE_PGE,
+        CPU_FEATURE_CMOV,
+        CPU_FEATURE_PAT,
+        CPU_FEATURE_CLFSH,
+        CPU_FEATURE_HTT,
+        CPU_FEATURE_PCLMULQDQ,
+        CPU_FEATURE_VMX,
+        CPU_FEATURE_SMX,
+        CPU_FEATURE_EST,
+        CPU_FEATURE_PCID,
+        CPU_FEATURE_X2APIC,
+        CPU_FEATURE_MOVBE,
+        CPU_FEATURE_TSC_DEADLINE,
+        CPU_FEATURE_AES,
+        CPU_FEATURE_OSXSAVE,
+        CPU_FEATURE_F16C,
+        CPU_FEATURE_HYPERVISOR,
+        CPU_FEATURE_FSGSBASE,
+        CPU_FEATURE_SGX,
+        CPU_FEATURE_BMI1,
+        CPU_FEATURE_HLE,
+        CPU_FEATURE_SMEP,
+        CPU_FEATURE_BMI2,
+        CPU_FEATURE_ERMS,
+        CPU_FEATURE_INVPCID,
+        CPU_FEATURE_RTM,
+        CPU_FEATURE_AVX512DQ,
+        CPU_FEATURE_ADX,
+        CPU_FEATURE_SMAP,
+        CPU_FEATURE_AVX512IFMA,
+        CPU_FEATURE_CLFLUSHOPT,
+        CPU_FEATURE_CLWB,
+        CPU_FEATURE_PT,
+        CPU_FEATURE_AVX512PF,
+        CPU_FEATURE_AVX512ER,
+        CPU_FEATURE_AVX512CD,
+        CPU_FEATURE_SHA,
+        CPU_FEATURE_AVX512BW,
+        CPU_FEATURE_AVX512VL,
+        CPU_FEATURE_PREFETCHWT1,
+        CPU_FEATURE_AVX512VBMI,
+        CPU_FEATURE_UMIP,
+        CPU_FEATURE_PKU,
+        CPU_FEATURE_WAITPKG,
+        CPU_FEATURE_AVX512VBMI2,
+        CPU_FEATURE_CET_SS,
+        CPU_FEATURE_GFNI,
+        CPU_FEATURE_VAES,
+        CPU_FEATURE_VPCLMULQDQ,
+        CPU_FEATURE_AVX512VNNI,
+        CPU_FEATURE_AVX512BITALG,
+        CPU_FEATURE_AVX512VPOPCNTDQ,
+        CPU_FEATURE_LA57,
+        CPU_FEATURE_RDPID,
+        CPU_FEATURE_CLDEMOTE,
+        CPU_FEATURE_MOVDIRI,
+        CPU_FEATURE_MOVDIR64B,
+        CPU_FEATURE_ENQCMD,
+        CPU_FEATURE_AVX512_4VNNIW,
+        CPU_FEATURE_AVX512_4FMAPS,
+        CPU_FEATURE_FSRM,
+        CPU_FEATURE_UINTR,
+        CPU_FEATURE_AVX512VP2INTERSECT,
+        CPU_FEATURE_MD_CLEAR,
+        CPU_FEATURE_SERIALIZE,
+        CPU_FEATURE_HYBRID,
+        CPU_FEATURE_TSXLDTRK,
+        CPU_FEATURE_CET_IBT,
+        CPU_FEATURE_AMX_BF16,
+        CPU_FEATURE_AVX512FP16,
+        CPU_FEATURE_AMX_TILE,
+        CPU_FEATURE_AMX_INT8,
+        CPU_FEATURE_AVX_VNNI,
+        CPU_FEATURE_AVX512BF16,
+        CPU_FEATURE_CMPCCXADD,
+        CPU_FEATURE_FZLRM,
+        CPU_FEATURE_FSRS,
+        CPU_FEATURE_FSRCS,
+        CPU_FEATURE_AMX_FP16,
+        CPU_FEATURE_HRESET,
+        CPU_FEATURE_AVX_IFMA,
+        CPU_FEATURE_LAM,
+        CPU_FEATURE_XSAVEOPT,
+        CPU_FEATURE_XSAVEC,
+        CPU_FEATURE_XSAVES,
+        CPU_FEATURE_LAHF_LM,
+        CPU_FEATURE_SVM,
+        CPU_FEATURE_LZCNT,
+        CPU_FEATURE_MISALIGNSSE,
+        CPU_FEATURE_PREFETCHW,
+        CPU_FEATURE_XOP,
+        CPU_FEATURE_TBM,
+        CPU_FEATURE_TOPOEXT,
+        CPU_FEATURE_PERFCTR_CORE,
+        CPU_FEATURE_MONITORX,
+        CPU_FEATURE_SYSCALL,
+        CPU_FEATURE_MMXEXT,
+        CPU_FEATURE_PDPE1GB,
+        CPU_FEATURE_RDTSCP,
+        CPU_FEATURE_LM,
+        CPU_FEATURE_INVARIANT_TSC,
+        CPU_FEATURE_CPB,
+        CPU_FEATURE_CLZERO,
+        CPU_FEATURE_INVLPGB,
+        CPU_FEATURE_RDPRU,
+        CPU_FEATURE_MCOMMIT,
+        CPU_FEATURE_WBNOINVD
+};
+static const VendorSignature g_vendor_signatures[] = {
+        {{"AMDisbetter!"}, CPU_VENDOR_AMD},// Very early AMD chips used this
+        {{"AuthenticAMD"}, CPU_VENDOR_AMD},
+        {{"GenuineIntel"}, CPU_VENDOR_INTEL},
+        {{"CyrixInstead"}, CPU_VENDOR_CYRIX},
+        {{"CentaurHauls"}, CPU_VENDOR_VIA},
+        {{"VIA VIA VIA "}, CPU_VENDOR_VIA},
+        {{"GenuineTMx86"}, CPU_VENDOR_TRANSMETA},
+        {{"SiS SiS SiS "}, CPU_VENDOR_SIS},
+        {{"UMC UMC UMC "}, CPU_VENDOR_UMC},
+        {{"RiseRiseRise"}, CPU_VENDOR_RISE},
+        {{"NexGenDriven"}, CPU_VENDOR_NEXGEN},
+        {{"Geode by NSC"}, CPU_VENDOR_NSC},
+        // Virtual CPUs
+        {{"KVMKVMKVMKVM"}, CPU_VENDOR_KVM},
+        {{"KVMKVMKVM\0\0\0"}, CPU_VENDOR_KVM},
+        {{"TCGTCGTCGTCG"}, CPU_VENDOR_QEMU},
+        {{"Microsoft Hv"}, CPU_VENDOR_HYPERV},
+        {{" lrpepyh  vr"}, CPU_VENDOR_PARALLELS},
+        {{"VMwareVMware"}, CPU_VENDOR_VMWARE},
+        {{"XenVMMXenVMM"}, CPU_VENDOR_XENHVM},
+        {{"ACRNACRNACRN"}, CPU_VENDOR_ACRN},
+        {{" QNXQVMBSQG "}, CPU_VENDOR_QNX},
+        {{"VirtualApple"}, CPU_VENDOR_ROSETTA},
+        {{"bhyve bhyve "}, CPU_VENDOR_BHYVE},
+        {{"MicrosoftXTA"}, CPU_VENDOR_MSXTA}
+};
+// Features which raise #UD unless the SSE and AVX state components are enabled in XCR0
+static const CPUFeature g_avx_features[] = {
+        CPU_FEATURE_AVX,
+        CPU_FEATURE_AVX2,
+        CPU_FEATURE_FMA3,
+        CPU_FEATURE_FMA4,
+        CPU_FEATURE_XOP,
+        CPU_FEATURE_F16C,
+        CPU_FEATURE_VAES,
+        CPU_FEATURE_VPCLMULQDQ,
+        CPU_FEATURE_AVX_VNNI,
+        CPU_FEATURE_AVX_IFMA
+};
+// Features which additionally require the opmask, ZMM_Hi256 and Hi16_ZMM state components
+static const CPUFeature g_avx512_features[] = {
+        CPU_FEATURE_AVX512,
+        CPU_FEATURE_AVX512DQ,
+        CPU_FEATURE_AVX512IFMA,
+        CPU_FEATURE_AVX512PF,
+        CPU_FEATURE_AVX512ER,
+        CPU_FEATURE_AVX512CD,
+        CPU_FEATURE_AVX512BW,
+        CPU_FEATURE_AVX512VL,
+        CPU_FEATURE_AVX512VBMI,
+        CPU_FEATURE_AVX512VBMI2,
+        CPU_FEATURE_AVX512VNNI,
+        CPU_FEATURE_AVX512BITALG,
+        CPU_FEATURE_AVX512VPOPCNTDQ,
+        CPU_FEATURE_AVX512_4VNNIW,
+        CPU_FEATURE_AVX512_4FMAPS,
+        CPU_FEATURE_AVX512VP2INTERSECT,
+        CPU_FEATURE_AVX512FP16,
+        CPU_FEATURE_AVX512BF16
 };
 // clang-format on
 // NOLINTEND
 
+
 DEFINE_CR_GET(cr0, CPU_CR0)
 DEFINE_CR_SET(cr0, CPU_CR0)
 DEFINE_CR_GET(cr4, CPU_CR4)
 DEFINE_CR_SET(cr4, CPU_CR4)
-DEFINE_CR_GET(efer, CPU_EFER)
-DEFINE_CR_SET(efer, CPU_EFER)
+
+static cpu_usize get_cr3() {
+    cpu_usize value = 0;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_out(value)),
+        _clobs(),
+        _emitI(mov _reg(cr3), _var(value))
+    );// clang-format on
+    return value;
+}
 
 static void get_xcr0(CPU_XCR0* value) {
     _assemble(// clang-format off
         _ins(),
         _outs(_inout(value)),
-        _clobs(_clob(rcx), _clob(edx), _clob(eax)),
+        _clobs(_clob(rcx), _clob(edx), _clob(eax), _clob(memory)),
         _emitI(xor _reg(rcx), _reg(rcx))
         _emitI(xgetbv)
         _emitI(mov _reg(edx), _get(_var(value), 0x04))
@@ -135,6 +356,27 @@ static void init_fxsr() {
     set_cr4(&cr4);
 }
 
+static void init_fsgsbase() {
+    CPU_CR4 cr4;
+    get_cr4(&cr4);
+    if(cr4.fsgsbase) {
+        return;
+    }
+    cr4.fsgsbase = LCPU_TRUE;
+    set_cr4(&cr4);
+}
+
+// PCIDE can only be set in IA-32e mode while the PCID of the current address space is 0
+static void init_pcid() {
+    CPU_CR4 cr4;
+    get_cr4(&cr4);
+    if(cr4.pcide || (get_cr3() & 0xFFF) != 0) {
+        return;
+    }
+    cr4.pcide = LCPU_TRUE;
+    set_cr4(&cr4);
+}
+
 static void init_fpu() {
     _assemble(_ins(), _outs(), _clobs(), _emitI(fninit));
     CPU_CR0 cr0;
@@ -143,7 +385,9 @@ static void init_fpu() {
     cr0.mp = LCPU_TRUE; // Enable co-processor monitoring
     set_cr0(&cr0);
 
-    if((cpu_get_features() & CPU_FEATURE_XSAVE) == CPU_FEATURE_XSAVE) {
+    CPU_CR4 cr4;
+    get_cr4(&cr4);
+    if(cr4.osxsave) {// XCR0 is only accessible once XSAVE was enabled
         CPU_XCR0 xcr0;
         get_xcr0(&xcr0);
         if(xcr0.x87) {
@@ -174,11 +418,27 @@ static void init_avx() {
     set_xcr0(&xcr0);
 }
 
+// The three AVX-512 state components can only be enabled together, on top of SSE and AVX
+static void init_avx512() {
+    CPU_XCR0 xcr0;
+    get_xcr0(&xcr0);
+    if(!xcr0.sse || !xcr0.avx) {
+        return;
+    }
+    if(xcr0.opmask && xcr0.zmm_hi256 && xcr0.hi16_zmm) {
+        return;
+    }
+    xcr0.opmask = LCPU_TRUE;
+    xcr0.zmm_hi256 = LCPU_TRUE;
+    xcr0.hi16_zmm = LCPU_TRUE;
+    set_xcr0(&xcr0);
+}
+
 static void cpuid(cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value) {
     _assemble(// clang-format off
         _ins(_in(leaf), _in(sub_leaf)),
         _outs(_inout(value)),
-        _clobs(_clob(eax), _clob(ebx), _clob(edx), _clob(ecx)),
+        _clobs(_clob(eax), _clob(ebx), _clob(edx), _clob(ecx), _clob(memory)),
         _emitI(mov _var(leaf), _reg(eax))
         _emitI(mov _var(sub_leaf), _reg(ecx))
         _emitI(cpuid)
@@ -189,61 +449,443 @@ static void cpuid(cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value) {
     );// clang-format on
 }
 
+static cpu_bool is_leaf_supported(const CPUInfo* info, cpu_u32 leaf) {
+    if(leaf >= 0x80000000) {
+        return leaf <= info->max_ext_leaf;
+    }
+    if(leaf >= 0x40000000) {
+        // The signature leaf is queried before the range is known
+        return leaf == 0x40000000 ? cpu_feature_set_test(&info->features, CPU_FEATURE_HYPERVISOR)
+                                  : leaf <= info->max_hv_leaf;
+    }
+    return leaf <= info->max_leaf;
+}
+
+static cpu_bool find_cached_cpuid(const CPUInfo* info, cpu_usize num_leaves, cpu_u32 leaf, cpu_u32 sub_leaf,
+                                   CPUID* value) {
+    for(cpu_usize index = 0; index < num_leaves; ++index) {
+        const CPUIDCacheEntry* entry = &info->leaves[index];
+        if(entry->leaf == leaf && entry->sub_leaf == sub_leaf) {
+            *value = entry->value;
+            return LCPU_TRUE;
+        }
+    }
+    return LCPU_FALSE;
+}
+
+// Lookups are lock-free, entries are only appended and published through the leaf count
+static void cache_cpuid(CPUInfo* info, cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value) {
+    const cpu_usize num_leaves = cpu_atomic_loadsize(&info->num_leaves, CPU_MEMORY_ORDER_ACQUIRE);
+    if(find_cached_cpuid(info, num_leaves, leaf, sub_leaf, value)) {
+        return;
+    }
+    if(!is_leaf_supported(info, leaf)) {
+        LCPU_MEMSET(value, 0, sizeof(CPUID));
+        return;
+    }
+    cpuid(leaf, sub_leaf, value);
+    cpu_ticket_lock_acquire(&g_cpuid_lock);
+    CPUID cached_value;
+    const cpu_usize current_num_leaves = info->num_leaves;
+    if(!find_cached_cpuid(info, current_num_leaves, leaf, sub_leaf, &cached_value) &&
+       current_num_leaves < LCPU_CPUID_CACHE_SIZE) {
+        CPUIDCacheEntry* entry = &info->leaves[current_num_leaves];
+        entry->leaf = leaf;
+        entry->sub_leaf = sub_leaf;
+        entry->value = *value;
+        cpu_atomic_storesize(&info->num_leaves, current_num_leaves + 1, CPU_MEMORY_ORDER_RELEASE);
+    }
+    cpu_ticket_lock_release(&g_cpuid_lock);
+}
+
+static CPUVendor match_vendor(cpu_u32 word0, cpu_u32 word1, cpu_u32 word2) {
+    for(cpu_usize index = 0; index < LCPU_ARRAYLEN(g_vendor_signatures); ++index) {
+        const VendorSignature* signature = &g_vendor_signatures[index];
+        if(signature->words[0] == word0 && signature->words[1] == word1 && signature->words[2] == word2) {
+            return signature->vendor;
+        }
+    }
+    return CPU_VENDOR_UNKNOWN;
+}
+
+static CPUVendor detect_vendor(CPUInfo* info) {
+    CPUID leaf;
+    cache_cpuid(info, 0, 0, &leaf);// CPUID leaf 0 for 12-char vendor code in EBX, EDX, ECX
+    return match_vendor(leaf.ebx.value, leaf.edx.value, leaf.ecx.value);
+}
+
+static void detect_hypervisor(CPUInfo* info) {
+    if(!cpu_feature_set_test(&info->features, CPU_FEATURE_HYPERVISOR)) {
+        return;// Leaf 0x40000000 aliases the highest basic leaf on bare metal
+    }
+    CPUID leaf;
+    cache_cpuid(info, 0x40000000, 0, &leaf);// Signature in EBX, ECX, EDX
+    info->hypervisor = match_vendor(leaf.ebx.value, leaf.ecx.value, leaf.edx.value);
+    info->max_hv_leaf = leaf.eax.value;
+    if(info->max_hv_leaf < 0x40000000) {
+        // Older KVM versions report 0 but implement the feature leaf
+        info->max_hv_leaf = info->hypervisor == CPU_VENDOR_KVM ? 0x40000001 : 0x40000000;
+    }
+}
+
+static void detect_features(CPUInfo* info, CPUFeatureSet* features) {
+    CPUID leaf;
+    cache_cpuid(info, 1, 0, &leaf);
+    // EDX
+    SET_FEATURE_IF(leaf.edx.leaf1.fpu, *features, CPU_FEATURE_X87);
+    SET_FEATURE_IF(leaf.edx.leaf1.pse, *features, CPU_FEATURE_PSE);
+    SET_FEATURE_IF(leaf.edx.leaf1.tsc, *features, CPU_FEATURE_RDTSC);
+    SET_FEATURE_IF(leaf.edx.leaf1.msr, *features, CPU_FEATURE_MSR);
+    SET_FEATURE_IF(leaf.edx.leaf1.pae, *features, CPU_FEATURE_PAE);
+    SET_FEATURE_IF(leaf.edx.leaf1.cx8, *features, CPU_FEATURE_CX8);
+    SET_FEATURE_IF(leaf.edx.leaf1.apic, *features, CPU_FEATURE_APIC);
+    SET_FEATURE_IF(leaf.edx.leaf1.sep, *features, CPU_FEATURE_SEP);
+    SET_FEATURE_IF(leaf.edx.leaf1.mtrr, *features, CPU_FEATURE_MTRR);
+    SET_FEATURE_IF(leaf.edx.leaf1.pge, *features, CPU_FEATURE_PGE);
+    SET_FEATURE_IF(leaf.edx.leaf1.cmov, *features, CPU_FEATURE_CMOV);
+    SET_FEATURE_IF(leaf.edx.leaf1.pat, *features, CPU_FEATURE_PAT);
+    SET_FEATURE_IF(leaf.edx.leaf1.clfsh, *features, CPU_FEATURE_CLFSH);
+    SET_FEATURE_IF(leaf.edx.leaf1.mmx, *features, CPU_FEATURE_MMX);
+    SET_FEATURE_IF(leaf.edx.leaf1.fxsr, *features, CPU_FEATURE_FXSR);
+    SET_FEATURE_IF(leaf.edx.leaf1.sse, *features, CPU_FEATURE_SSE);
+    SET_FEATURE_IF(leaf.edx.leaf1.sse2, *features, CPU_FEATURE_SSE2);
+    SET_FEATURE_IF(leaf.edx.leaf1.htt, *features, CPU_FEATURE_HTT);
+    // ECX
+    SET_FEATURE_IF(leaf.ecx.leaf1.sse3, *features, CPU_FEATURE_SSE3);
+    SET_FEATURE_IF(leaf.ecx.leaf1.pclmulqdq, *features, CPU_FEATURE_PCLMULQDQ);
+    SET_FEATURE_IF(leaf.ecx.leaf1.monitor, *features, CPU_FEATURE_MONITOR);
+    SET_FEATURE_IF(leaf.ecx.leaf1.vmx, *features, CPU_FEATURE_VMX);
+    SET_FEATURE_IF(leaf.ecx.leaf1.smx, *features, CPU_FEATURE_SMX);
+    SET_FEATURE_IF(leaf.ecx.leaf1.est, *features, CPU_FEATURE_EST);
+    SET_FEATURE_IF(leaf.ecx.leaf1.ssse3, *features, CPU_FEATURE_SSSE3);
+    SET_FEATURE_IF(leaf.ecx.leaf1.fma, *features, CPU_FEATURE_FMA3);
+    SET_FEATURE_IF(leaf.ecx.leaf1.cx16, *features, CPU_FEATURE_CX16);
+    SET_FEATURE_IF(leaf.ecx.leaf1.pcid, *features, CPU_FEATURE_PCID);
+    SET_FEATURE_IF(leaf.ecx.leaf1.sse4_1, *features, CPU_FEATURE_SSE4_1);
+    SET_FEATURE_IF(leaf.ecx.leaf1.sse4_2, *features, CPU_FEATURE_SSE4_2);
+    SET_FEATURE_IF(leaf.ecx.leaf1.x2apic, *features, CPU_FEATURE_X2APIC);
+    SET_FEATURE_IF(leaf.ecx.leaf1.movbe, *features, CPU_FEATURE_MOVBE);
+    SET_FEATURE_IF(leaf.ecx.leaf1.popcnt, *features, CPU_FEATURE_POPCNT);
+    SET_FEATURE_IF(leaf.ecx.leaf1.tsc_deadline, *features, CPU_FEATURE_TSC_DEADLINE);
+    SET_FEATURE_IF(leaf.ecx.leaf1.aes_ni, *features, CPU_FEATURE_AES);
+    SET_FEATURE_IF(leaf.ecx.leaf1.xsave, *features, CPU_FEATURE_XSAVE);
+    SET_FEATURE_IF(leaf.ecx.leaf1.osxsave, *features, CPU_FEATURE_OSXSAVE);
+    SET_FEATURE_IF(leaf.ecx.leaf1.avx, *features, CPU_FEATURE_AVX);
+    SET_FEATURE_IF(leaf.ecx.leaf1.f16c, *features, CPU_FEATURE_F16C);
+    SET_FEATURE_IF(leaf.ecx.leaf1.rdrnd, *features, CPU_FEATURE_RDRND);
+    SET_FEATURE_IF(leaf.ecx.leaf1.hypervisor, *features, CPU_FEATURE_HYPERVISOR);
+
+    cache_cpuid(info, 7, 0, &leaf);
+    const cpu_u32 max_leaf7_sub_leaf = leaf.eax.value;
+    // EBX
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.fsgsbase, *features, CPU_FEATURE_FSGSBASE);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.sgx, *features, CPU_FEATURE_SGX);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.bmi1, *features, CPU_FEATURE_BMI1);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.hle, *features, CPU_FEATURE_HLE);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx2, *features, CPU_FEATURE_AVX2);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.smep, *features, CPU_FEATURE_SMEP);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.bmi2, *features, CPU_FEATURE_BMI2);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.erms, *features, CPU_FEATURE_ERMS);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.invpcid, *features, CPU_FEATURE_INVPCID);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.rtm, *features, CPU_FEATURE_RTM);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_f, *features, CPU_FEATURE_AVX512);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_dq, *features, CPU_FEATURE_AVX512DQ);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.rdseed, *features, CPU_FEATURE_RDSEED);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.adx, *features, CPU_FEATURE_ADX);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.smap, *features, CPU_FEATURE_SMAP);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_ifma, *features, CPU_FEATURE_AVX512IFMA);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.clflushopt, *features, CPU_FEATURE_CLFLUSHOPT);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.clwb, *features, CPU_FEATURE_CLWB);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.pt, *features, CPU_FEATURE_PT);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_pf, *features, CPU_FEATURE_AVX512PF);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_er, *features, CPU_FEATURE_AVX512ER);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_cd, *features, CPU_FEATURE_AVX512CD);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.sha, *features, CPU_FEATURE_SHA);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_bw, *features, CPU_FEATURE_AVX512BW);
+    SET_FEATURE_IF(leaf.ebx.leaf7_0.avx512_vl, *features, CPU_FEATURE_AVX512VL);
+    // ECX
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.prefetchwt1, *features, CPU_FEATURE_PREFETCHWT1);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.avx512_vdmi, *features, CPU_FEATURE_AVX512VBMI);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.umip, *features, CPU_FEATURE_UMIP);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.pku, *features, CPU_FEATURE_PKU);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.waitpkg, *features, CPU_FEATURE_WAITPKG);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.avx512_vdmi2, *features, CPU_FEATURE_AVX512VBMI2);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.cetss_shstk, *features, CPU_FEATURE_CET_SS);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.gfni, *features, CPU_FEATURE_GFNI);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.vaes, *features, CPU_FEATURE_VAES);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.vpclmulqdq, *features, CPU_FEATURE_VPCLMULQDQ);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.avx512_vnni, *features, CPU_FEATURE_AVX512VNNI);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.avx512_bitalg, *features, CPU_FEATURE_AVX512BITALG);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.avx512_vpopcntdq, *features, CPU_FEATURE_AVX512VPOPCNTDQ);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.la57, *features, CPU_FEATURE_LA57);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.rdpid, *features, CPU_FEATURE_RDPID);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.cldemote, *features, CPU_FEATURE_CLDEMOTE);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.movdiri, *features, CPU_FEATURE_MOVDIRI);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.movdir64b, *features, CPU_FEATURE_MOVDIR64B);
+    SET_FEATURE_IF(leaf.ecx.leaf7_0.enqcmd, *features, CPU_FEATURE_ENQCMD);
+    // EDX
+    SET_FEATURE_IF(leaf.edx.leaf7_0.avx512_4vnniw, *features, CPU_FEATURE_AVX512_4VNNIW);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.avx512_4fmaps, *features, CPU_FEATURE_AVX512_4FMAPS);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.fsrm, *features, CPU_FEATURE_FSRM);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.uintr, *features, CPU_FEATURE_UINTR);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.avx512_vp2intersect, *features, CPU_FEATURE_AVX512VP2INTERSECT);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.mc_clear, *features, CPU_FEATURE_MD_CLEAR);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.serialize, *features, CPU_FEATURE_SERIALIZE);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.hybrid, *features, CPU_FEATURE_HYBRID);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.tsxldtrk, *features, CPU_FEATURE_TSXLDTRK);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.cet_ibt, *features, CPU_FEATURE_CET_IBT);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.amx_bf16, *features, CPU_FEATURE_AMX_BF16);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.avx512_fp16, *features, CPU_FEATURE_AVX512FP16);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.amx_tile, *features, CPU_FEATURE_AMX_TILE);
+    SET_FEATURE_IF(leaf.edx.leaf7_0.amx_int8, *features, CPU_FEATURE_AMX_INT8);
+
+    if(max_leaf7_sub_leaf >= 1) {
+        cache_cpuid(info, 7, 1, &leaf);
+        // EAX
+        SET_FEATURE_IF(leaf.eax.leaf7_1.avx_vnni, *features, CPU_FEATURE_AVX_VNNI);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.avx512_bf16, *features, CPU_FEATURE_AVX512BF16);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.cmpccxadd, *features, CPU_FEATURE_CMPCCXADD);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.fzlrm, *features, CPU_FEATURE_FZLRM);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.fsrs, *features, CPU_FEATURE_FSRS);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.fsrcs, *features, CPU_FEATURE_FSRCS);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.amx_fp16, *features, CPU_FEATURE_AMX_FP16);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.hreset, *features, CPU_FEATURE_HRESET);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.avx_ifma, *features, CPU_FEATURE_AVX_IFMA);
+        SET_FEATURE_IF(leaf.eax.leaf7_1.lam, *features, CPU_FEATURE_LAM);
+    }
+
+    cache_cpuid(info, 0xD, 1, &leaf);
+    // EAX
+    SET_FEATURE_IF(leaf.eax.leafD_1.xsaveopt, *features, CPU_FEATURE_XSAVEOPT);
+    SET_FEATURE_IF(leaf.eax.leafD_1.xsavec, *features, CPU_FEATURE_XSAVEC);
+    SET_FEATURE_IF(leaf.eax.leafD_1.xsaves, *features, CPU_FEATURE_XSAVES);
+
+    cache_cpuid(info, 0x80000001, 0, &leaf);
+    // ECX
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.lahf_lm, *features, CPU_FEATURE_LAHF_LM);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.svm, *features, CPU_FEATURE_SVM);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.abm, *features, CPU_FEATURE_LZCNT);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.sse4a, *features, CPU_FEATURE_SSE4A);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.misalignsse, *features, CPU_FEATURE_MISALIGNSSE);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.tdnowprefetch, *features, CPU_FEATURE_PREFETCHW);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.xop, *features, CPU_FEATURE_XOP);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.fma4, *features, CPU_FEATURE_FMA4);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.tbm, *features, CPU_FEATURE_TBM);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.topoext, *features, CPU_FEATURE_TOPOEXT);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.perfctr_core, *features, CPU_FEATURE_PERFCTR_CORE);
+    SET_FEATURE_IF(leaf.ecx.leaf80000001.monitorx, *features, CPU_FEATURE_MONITORX);
+    // EDX
+    SET_FEATURE_IF(leaf.edx.leaf80000001.syscall, *features, CPU_FEATURE_SYSCALL);
+    SET_FEATURE_IF(leaf.edx.leaf80000001.nx, *features, CPU_FEATURE_NX);
+    SET_FEATURE_IF(leaf.edx.leaf80000001.mmxext, *features, CPU_FEATURE_MMXEXT);
+    SET_FEATURE_IF(leaf.edx.leaf80000001.pdpe1gb, *features, CPU_FEATURE_PDPE1GB);
+    SET_FEATURE_IF(leaf.edx.leaf80000001.rdtscp, *features, CPU_FEATURE_RDTSCP);
+    SET_FEATURE_IF(leaf.edx.leaf80000001.lm, *features, CPU_FEATURE_LM);
+
+    cache_cpuid(info, 0x80000007, 0, &leaf);
+    // EDX
+    SET_FEATURE_IF(leaf.edx.leaf80000007.invariant_tsc, *features, CPU_FEATURE_INVARIANT_TSC);
+    SET_FEATURE_IF(leaf.edx.leaf80000007.cpb, *features, CPU_FEATURE_CPB);
+
+    cache_cpuid(info, 0x80000008, 0, &leaf);
+    // EBX
+    SET_FEATURE_IF(leaf.ebx.leaf80000008.clzero, *features, CPU_FEATURE_CLZERO);
+    SET_FEATURE_IF(leaf.ebx.leaf80000008.invlpgb, *features, CPU_FEATURE_INVLPGB);
+    SET_FEATURE_IF(leaf.ebx.leaf80000008.rdpru, *features, CPU_FEATURE_RDPRU);
+    SET_FEATURE_IF(leaf.ebx.leaf80000008.mcommit, *features, CPU_FEATURE_MCOMMIT);
+    SET_FEATURE_IF(leaf.ebx.leaf80000008.wbnoinvd, *features, CPU_FEATURE_WBNOINVD);
+}
+
+// The processor ID is cached in TSC_AUX once per-CPU data is set up, so this is cheap in the common case
+// Only claims a slot if requested, so queries from processors which never initialized don't fill the table
+static CoreState* get_core_state(cpu_u32 id, cpu_bool is_claiming) {
+    const cpu_u32 key = id + 1;
+    for(cpu_u32 probe = 0; probe < CORE_TABLE_SIZE; ++probe) {
+        CoreState* core = &g_cores[(key + probe) & (CORE_TABLE_SIZE - 1)];
+        cpu_u32 current_key = cpu_atomic_load32(&core->key, CPU_MEMORY_ORDER_ACQUIRE);
+        if(current_key == key) {
+            return core;
+        }
+        if(current_key != CORE_KEY_EMPTY) {
+            continue;
+        }
+        if(!is_claiming) {
+            return nullptr;
+        }
+        if(cpu_atomic_compare_exchange32(&core->key, &current_key, key, CPU_MEMORY_ORDER_ACQ_REL)) {
+            cpu_atomic_fetch_add32(&g_num_cores, 1, CPU_MEMORY_ORDER_RELEASE);
+            return core;
+        }
+    }
+    return is_claiming ? &g_overflow_core : nullptr;
+}
+
+// Setting a state component the processor doesn't support in XCR0 raises #GP
+static cpu_bool is_xcr0_supported(cpu_u32 mask) {
+    CPUID leaf;
+    cache_cpuid(&g_info, 0xD, 0, &leaf);
+    return (leaf.eax.value & mask) == mask;
+}
+
+// Brings the control registers of the current processor in line with the given features
+static void init_core(const CPUFeatureSet* features) {
+    CALL_IF_ENABLED(*features, CPU_FEATURE_FXSR, init_fxsr);
+    CALL_IF_ENABLED(*features, CPU_FEATURE_XSAVE, init_xsave);
+    if(cpu_feature_set_test(features, CPU_FEATURE_X87) || cpu_feature_set_test(features, CPU_FEATURE_MMX)) {
+        init_fpu();
+    }
+    // XCR0 state components can only be enabled through XSAVE
+    if(cpu_feature_set_test(features, CPU_FEATURE_XSAVE)) {
+        CALL_IF_ENABLED(*features, CPU_FEATURE_SSE, init_sse);
+#ifdef CPU_64_BIT
+        CALL_IF_ENABLED(*features, CPU_FEATURE_AVX, init_avx);
+        if(is_xcr0_supported(XCR0_AVX512_MASK)) {
+            CALL_IF_ENABLED(*features, CPU_FEATURE_AVX512, init_avx512);
+        }
+#endif
+    }
+#ifdef CPU_64_BIT
+    CALL_IF_ENABLED(*features, CPU_FEATURE_FSGSBASE, init_fsgsbase);
+    CALL_IF_ENABLED(*features, CPU_FEATURE_PCID, init_pcid);
+#endif
+}
+
+static void clear_features(CPUFeatureSet* features, const CPUFeature* list, cpu_usize count) {
+    for(cpu_usize index = 0; index < count; ++index) {
+        cpu_feature_set_clear(features, list[index]);
+    }
+}
+
+// Drop every feature whose state couldn't be enabled, so the enabled set only holds usable features
+static void verify_features(CPUFeatureSet* features) {
+    CPU_XCR0 xcr0 = {0};
+    CPU_CR4 cr4;
+    get_cr4(&cr4);
+    if(cr4.osxsave) {
+        get_xcr0(&xcr0);
+    }
+    if(!xcr0.sse || !xcr0.avx) {
+        clear_features(features, g_avx_features, LCPU_ARRAYLEN(g_avx_features));
+    }
+    if(!xcr0.sse || !xcr0.avx || !xcr0.opmask || !xcr0.zmm_hi256 || !xcr0.hi16_zmm) {
+        clear_features(features, g_avx512_features, LCPU_ARRAYLEN(g_avx512_features));
+    }
+    if(!cr4.pcide) {
+        cpu_feature_set_clear(features, CPU_FEATURE_PCID);
+    }
+}
+
+CPUInfo* lcpu_get_info() {
+    if(cpu_atomic_load32(&g_info_state, CPU_MEMORY_ORDER_ACQUIRE) == INFO_STATE_VALID) {
+        return &g_info;
+    }
+    // The first processor to get here enumerates, all others wait for it
+    cpu_u32 state = INFO_STATE_INVALID;
+    if(!cpu_atomic_compare_exchange32(&g_info_state, &state, INFO_STATE_ENUMERATING, CPU_MEMORY_ORDER_ACQUIRE)) {
+        while(cpu_atomic_load32(&g_info_state, CPU_MEMORY_ORDER_ACQUIRE) != INFO_STATE_VALID) {
+            cpu_hint_spin();
+        }
+        return &g_info;
+    }
+    CPUInfo* info = &g_info;
+    LCPU_MEMSET(info, 0, sizeof(CPUInfo));
+
+    CPUID leaf;
+    cpuid(0, 0, &leaf);
+    info->max_leaf = leaf.eax.value;
+    cpuid(0x80000000, 0, &leaf);
+    info->max_ext_leaf = leaf.eax.value >= 0x80000000 ? leaf.eax.value : 0;
+
+    info->vendor = detect_vendor(info);
+    detect_features(info, &info->features);
+    detect_hypervisor(info);
+    cpu_atomic_store32(&g_info_state, INFO_STATE_VALID, CPU_MEMORY_ORDER_RELEASE);
+    return info;
+}
+
+void lcpu_decode_lock() {
+    cpu_ticket_lock_acquire(&g_decode_lock);
+}
+
+void lcpu_decode_unlock() {
+    cpu_ticket_lock_release(&g_decode_lock);
+}
+
+void lcpu_cpuid(cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value) {
+    cache_cpuid(lcpu_get_info(), leaf, sub_leaf, value);
+}
+
+void lcpu_cpuid_uncached(cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value) {
+    cpuid(leaf, sub_leaf, value);
+}
+
+void lcpu_get_xcr0(CPU_XCR0* value) {
+    get_xcr0(value);
+}
+
+void lcpu_get_cr0(CPU_CR0* value) {
+    get_cr0(value);
+}
+
+void lcpu_set_cr0(const CPU_CR0* value) {
+    set_cr0(value);
+}
+
+void lcpu_get_cr4(CPU_CR4* value) {
+    get_cr4(value);
+}
+
+void lcpu_set_cr4(const CPU_CR4* value) {
+    set_cr4(value);
+}
+
+CPUIDLeaf cpu_get_cpuid_leaf(cpu_u32 leaf, cpu_u32 sub_leaf) {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_CPUID_LEAF);
+    CPUID value;
+    lcpu_cpuid(leaf, sub_leaf, &value);
+    return (CPUIDLeaf){value.eax.value, value.ebx.value, value.ecx.value, value.edx.value};
+}
+
 cpu_usize cpu_get_gpr_width() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_GPR_WIDTH);
     return LCPU_GPR_BITS;
 }
 
 cpu_usize cpu_get_vr_width() {
-    const CPUFeature features = cpu_get_features();
-    if((features & CPU_FEATURE_AVX512) != 0) {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_VR_WIDTH);
+    const CPUFeatureSet* features = &lcpu_get_info()->features;
+    if(cpu_feature_set_test(features, CPU_FEATURE_AVX512)) {
         return 512;
     }
-    if((features & CPU_FEATURE_AVX) != 0) {
+    if(cpu_feature_set_test(features, CPU_FEATURE_AVX)) {
         return 256;
     }
-    if((features & CPU_FEATURE_SSE) != 0) {
+    if(cpu_feature_set_test(features, CPU_FEATURE_SSE)) {
         return 128;
     }
-    if((features & CPU_FEATURE_MMX) != 0) {
+    if(cpu_feature_set_test(features, CPU_FEATURE_MMX)) {
         return 64;
     }
     return cpu_get_gpr_width();
 }
 
 CPUVendor cpu_get_vendor() {
-    CPUID info;
-    cpuid(0, 0, &info);// CPUID leaf 0 for 12-char vendor code
-
-    RETURN_IF_MATCH(&info, "AMDisbetter!", 12, CPU_VENDOR_AMD);// Very early AMD chips used this
-    RETURN_IF_MATCH(&info, "AuthenticAMD", 12, CPU_VENDOR_AMD);
-    RETURN_IF_MATCH(&info, "GenuineIntel", 12, CPU_VENDOR_INTEL);
-    RETURN_IF_MATCH(&info, "CyrixInstead", 12, CPU_VENDOR_CYRIX);
-    RETURN_IF_MATCH(&info, "CentaurHauls", 12, CPU_VENDOR_VIA);
-    RETURN_IF_MATCH(&info, "VIA VIA VIA ", 12, CPU_VENDOR_VIA);
-    RETURN_IF_MATCH(&info, "GenuineTMx86", 12, CPU_VENDOR_TRANSMETA);
-    RETURN_IF_MATCH(&info, "SiS SiS SiS ", 12, CPU_VENDOR_SIS);
-    RETURN_IF_MATCH(&info, "UMC UMC UMC ", 12, CPU_VENDOR_UMC);
-    RETURN_IF_MATCH(&info, "RiseRiseRise", 12, CPU_VENDOR_RISE);
-    RETURN_IF_MATCH(&info, "NexGenDriven", 12, CPU_VENDOR_NEXGEN);
-    RETURN_IF_MATCH(&info, "Geode by NSC", 12, CPU_VENDOR_NSC);
-    // Virtual CPUs
-    RETURN_IF_MATCH(&info, "KVMKVMKVMKVM", 12, CPU_VENDOR_KVM);
-    RETURN_IF_MATCH(&info, "KVMKVMKVM\0\0\0", 12, CPU_VENDOR_KVM);
-    RETURN_IF_MATCH(&info, "TCGTCGTCGTCG", 12, CPU_VENDOR_QEMU);
-    RETURN_IF_MATCH(&info, "Microsoft Hv", 12, CPU_VENDOR_HYPERV);
-    RETURN_IF_MATCH(&info, " lrpepyh  vr", 12, CPU_VENDOR_PARALLELS);
-    RETURN_IF_MATCH(&info, "VMwareVMware", 12, CPU_VENDOR_VMWARE);
-    RETURN_IF_MATCH(&info, "XenVMMXenVMM", 12, CPU_VENDOR_XENHVM);
-    RETURN_IF_MATCH(&info, "ACRNACRNACRN", 12, CPU_VENDOR_ACRN);
-    RETURN_IF_MATCH(&info, " QNXQVMBSQG ", 12, CPU_VENDOR_QNX);
-    RETURN_IF_MATCH(&info, "VirtualApple", 12, CPU_VENDOR_ROSETTA);
-    RETURN_IF_MATCH(&info, "bhyve bhyve ", 12, CPU_VENDOR_BHYVE);
-    RETURN_IF_MATCH(&info, "MicrosoftXTA", 12, CPU_VENDOR_MSXTA);
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_VENDOR);
+    return lcpu_get_info()->vendor;
+}
 
-    return CPU_VENDOR_UNKNOWN;
+CPUVendor cpu_get_hypervisor() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_HYPERVISOR);
+    return lcpu_get_info()->hypervisor;
+}
+
+cpu_u32 cpu_get_hypervisor_max_leaf() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_HYPERVISOR_MAX_LEAF);
+    return lcpu_get_info()->max_hv_leaf;
 }
 
 const char* cpu_vendor_get_name(CPUVendor vendor) {
+    LCPU_INSTRUMENT(CPU_STATS_API_VENDOR_GET_NAME);
     switch(vendor) {// clang-format off
         case CPU_VENDOR_AMD:        return "Advanced Micro Devices";
         case CPU_VENDOR_INTEL:      return "Intel";
@@ -271,159 +913,271 @@ const char* cpu_vendor_get_name(CPUVendor vendor) {
     }// clang-format on
 }
 
-CPUFeature cpu_get_features() {
-    CPUFeature features = CPU_FEATURE_NONE;
-    CPUID info;
-    cpuid(1, 0, &info);
-    // EDX
-    SET_BIT_IF(info.edx.leaf1.fpu, features, CPU_FEATURE_X87);
-    SET_BIT_IF(info.edx.leaf1.mmx, features, CPU_FEATURE_MMX);
-    SET_BIT_IF(info.edx.leaf1.sse, features, CPU_FEATURE_SSE);
-    SET_BIT_IF(info.edx.leaf1.sse2, features, CPU_FEATURE_SSE2);
-    SET_BIT_IF(info.edx.leaf1.cx8, features, CPU_FEATURE_CX8);
-    SET_BIT_IF(info.edx.leaf1.fxsr, features, CPU_FEATURE_FXSR);
-    SET_BIT_IF(info.edx.leaf1.tsc, features, CPU_FEATURE_RDTSC);
-    // ECX
-    SET_BIT_IF(info.ecx.leaf1.sse3, features, CPU_FEATURE_SSE3);
-    SET_BIT_IF(info.ecx.leaf1.ssse3, features, CPU_FEATURE_SSSE3);
-    SET_BIT_IF(info.ecx.leaf1.sse4_1, features, CPU_FEATURE_SSE4_1);
-    SET_BIT_IF(info.ecx.leaf1.sse4_2, features, CPU_FEATURE_SSE4_2);
-    SET_BIT_IF(info.ecx.leaf1.avx, features, CPU_FEATURE_AVX);
-    SET_BIT_IF(info.ecx.leaf1.fma, features, CPU_FEATURE_FMA3);
-    SET_BIT_IF(info.ecx.leaf1.xsave, features, CPU_FEATURE_XSAVE);
-    SET_BIT_IF(info.ecx.leaf1.popcnt, features, CPU_FEATURE_POPCNT);
-    SET_BIT_IF(info.ecx.leaf1.cx16, features, CPU_FEATURE_CX16);
-    SET_BIT_IF(info.ecx.leaf1.rdrnd, features, CPU_FEATURE_RDRND);
-
-    cpuid(7, 0, &info);
-    // EBX
-    SET_BIT_IF(info.ebx.leaf7_0.rdseed, features, CPU_FEATURE_RDSEED);
-    SET_BIT_IF(info.ebx.leaf7_0.avx2, features, CPU_FEATURE_AVX2);
-    SET_BIT_IF(info.ebx.leaf7_0.avx512_f, features, CPU_FEATURE_AVX512);
-
-    cpuid(0x80000001, 0, &info);
-    // ECX
-    SET_BIT_IF(info.ecx.leaf80000001.sse4a, features, CPU_FEATURE_SSE4A);
-    SET_BIT_IF(info.ecx.leaf80000001.fma4, features, CPU_FEATURE_FMA4);
-    SET_BIT_IF(info.edx.leaf80000001.nx, features, CPU_FEATURE_NX);
-
-    return features;
+CPUFeatureSet cpu_get_features() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_FEATURES);
+    return lcpu_get_info()->features;
 }
 
-CPUFeature cpu_get_enabled_features() {
+CPUFeatureSet cpu_get_enabled_features() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_ENABLED_FEATURES);
     return g_enabled_features;
 }
 
 const CPUFeature* cpu_get_available_features() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_AVAILABLE_FEATURES);
     return g_available_features;
 }
 
 cpu_usize cpu_get_num_available_features() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_NUM_AVAILABLE_FEATURES);
     return LCPU_ARRAYLEN(g_available_features);
 }
 
 const char* cpu_feature_get_name(CPUFeature feature) {
+    LCPU_INSTRUMENT(CPU_STATS_API_FEATURE_GET_NAME);
     switch(feature) {// clang-format off
-        case CPU_FEATURE_X87:     return "x87";
-        case CPU_FEATURE_MMX:     return "MMX";
-        case CPU_FEATURE_SSE:     return "SSE";
-        case CPU_FEATURE_SSE2:    return "SSE2";
-        case CPU_FEATURE_SSE3:    return "SSE3";
-        case CPU_FEATURE_SSSE3:   return "SSSE3";
-        case CPU_FEATURE_SSE4_1:  return "SSE4.1";
-        case CPU_FEATURE_SSE4_2:  return "SSE4.2";
-        case CPU_FEATURE_SSE4A:   return "SSE4a";
-        case CPU_FEATURE_AVX:     return "AVX";
-        case CPU_FEATURE_AVX2:    return "AVX2";
-        case CPU_FEATURE_AVX512:  return "AVX512F";
-        case CPU_FEATURE_FMA3:    return "FMA3";
-        case CPU_FEATURE_FMA4:    return "FMA4";
-        case CPU_FEATURE_XSAVE:   return "XSAVE";
-        case CPU_FEATURE_FXSR:    return "FXSR";
-        case CPU_FEATURE_NX:      return "NX";
-        case CPU_FEATURE_RDRND:   return "RDRND";
-        case CPU_FEATURE_RDSEED:  return "RDSEED";
-        case CPU_FEATURE_RDTSC:   return "RDTSC";
-        case CPU_FEATURE_CX8:     return "CX8";
-        case CPU_FEATURE_CX16:    return "CX16";
-        case CPU_FEATURE_MONITOR: return "MONITOR";
-        case CPU_FEATURE_POPCNT:  return "POPCNT";
-        case CPU_FEATURE_NEON:    return "NEON";
-        case CPU_FEATURE_RVV:     return "RVV";
-        default:                  return "Unknown";
+        case CPU_FEATURE_X87:                return "x87";
+        case CPU_FEATURE_MMX:                return "MMX";
+        case CPU_FEATURE_SSE:                return "SSE";
+        case CPU_FEATURE_SSE2:               return "SSE2";
+        case CPU_FEATURE_SSE3:               return "SSE3";
+        case CPU_FEATURE_SSSE3:              return "SSSE3";
+        case CPU_FEATURE_SSE4_1:             return "SSE4.1";
+        case CPU_FEATURE_SSE4_2:             return "SSE4.2";
+        case CPU_FEATURE_SSE4A:              return "SSE4a";
+        case CPU_FEATURE_AVX:                return "AVX";
+        case CPU_FEATURE_AVX2:               return "AVX2";
+        case CPU_FEATURE_AVX512:             return "AVX512F";
+        case CPU_FEATURE_FMA3:               return "FMA3";
+        case CPU_FEATURE_FMA4:               return "FMA4";
+        case CPU_FEATURE_FXSR:               return "FXSR";
+        case CPU_FEATURE_XSAVE:              return "XSAVE";
+        case CPU_FEATURE_NX:                 return "NX";
+        case CPU_FEATURE_RDRND:              return "RDRND";
+        case CPU_FEATURE_RDSEED:             return "RDSEED";
+        case CPU_FEATURE_RDTSC:              return "RDTSC";
+        case CPU_FEATURE_CX8:                return "CX8";
+        case CPU_FEATURE_CX16:               return "CX16";
+        case CPU_FEATURE_MONITOR:            return "MONITOR";
+        case CPU_FEATURE_POPCNT:             return "POPCNT";
+        case CPU_FEATURE_NEON:               return "NEON";
+        case CPU_FEATURE_RVV:                return "RVV";
+        case CPU_FEATURE_PSE:                return "PSE";
+        case CPU_FEATURE_MSR:                return "MSR";
+        case CPU_FEATURE_PAE:                return "PAE";
+        case CPU_FEATURE_APIC:               return "APIC";
+        case CPU_FEATURE_SEP:                return "SEP";
+        case CPU_FEATURE_MTRR:               return "MTRR";
+        case CPU_FEATURE_PGE:                return "PGE";
+        case CPU_FEATURE_CMOV:               return "CMOV";
+        case CPU_FEATURE_PAT:                return "PAT";
+        case CPU_FEATURE_CLFSH:              return "CLFSH";
+        case CPU_FEATURE_HTT:                return "HTT";
+        case CPU_FEATURE_PCLMULQDQ:          return "PCLMULQDQ";
+        case CPU_FEATURE_VMX:                return "VMX";
+        case CPU_FEATURE_SMX:                return "SMX";
+        case CPU_FEATURE_EST:                return "EST";
+        case CPU_FEATURE_PCID:               return "PCID";
+        case CPU_FEATURE_X2APIC:             return "X2APIC";
+        case CPU_FEATURE_MOVBE:              return "MOVBE";
+        case CPU_FEATURE_TSC_DEADLINE:       return "TSC-Deadline";
+        case CPU_FEATURE_AES:                return "AES";
+        case CPU_FEATURE_OSXSAVE:            return "OSXSAVE";
+        case CPU_FEATURE_F16C:               return "F16C";
+        case CPU_FEATURE_HYPERVISOR:         return "HYPERVISOR";
+        case CPU_FEATURE_FSGSBASE:           return "FSGSBASE";
+        case CPU_FEATURE_SGX:                return "SGX";
+        case CPU_FEATURE_BMI1:               return "BMI1";
+        case CPU_FEATURE_HLE:                return "HLE";
+        case CPU_FEATURE_SMEP:               return "SMEP";
+        case CPU_FEATURE_BMI2:               return "BMI2";
+        case CPU_FEATURE_ERMS:               return "ERMS";
+        case CPU_FEATURE_INVPCID:            return "INVPCID";
+        case CPU_FEATURE_RTM:                return "RTM";
+        case CPU_FEATURE_AVX512DQ:           return "AVX512DQ";
+        case CPU_FEATURE_ADX:                return "ADX";
+        case CPU_FEATURE_SMAP:               return "SMAP";
+        case CPU_FEATURE_AVX512IFMA:         return "AVX512IFMA";
+        case CPU_FEATURE_CLFLUSHOPT:         return "CLFLUSHOPT";
+        case CPU_FEATURE_CLWB:               return "CLWB";
+        case CPU_FEATURE_PT:                 return "PT";
+        case CPU_FEATURE_AVX512PF:           return "AVX512PF";
+        case CPU_FEATURE_AVX512ER:           return "AVX512ER";
+        case CPU_FEATURE_AVX512CD:           return "AVX512CD";
+        case CPU_FEATURE_SHA:                return "SHA";
+        case CPU_FEATURE_AVX512BW:           return "AVX512BW";
+        case CPU_FEATURE_AVX512VL:           return "AVX512VL";
+        case CPU_FEATURE_PREFETCHWT1:        return "PREFETCHWT1";
+        case CPU_FEATURE_AVX512VBMI:         return "AVX512VBMI";
+        case CPU_FEATURE_UMIP:               return "UMIP";
+        case CPU_FEATURE_PKU:                return "PKU";
+        case CPU_FEATURE_WAITPKG:            return "WAITPKG";
+        case CPU_FEATURE_AVX512VBMI2:        return "AVX512VBMI2";
+        case CPU_FEATURE_CET_SS:             return "CET-SS";
+        case CPU_FEATURE_GFNI:               return "GFNI";
+        case CPU_FEATURE_VAES:               return "VAES";
+        case CPU_FEATURE_VPCLMULQDQ:         return "VPCLMULQDQ";
+        case CPU_FEATURE_AVX512VNNI:         return "AVX512VNNI";
+        case CPU_FEATURE_AVX512BITALG:       return "AVX512BITALG";
+        case CPU_FEATURE_AVX512VPOPCNTDQ:    return "AVX512VPOPCNTDQ";
+        case CPU_FEATURE_LA57:               return "LA57";
+        case CPU_FEATURE_RDPID:              return "RDPID";
+        case CPU_FEATURE_CLDEMOTE:           return "CLDEMOTE";
+        case CPU_FEATURE_MOVDIRI:            return "MOVDIRI";
+        case CPU_FEATURE_MOVDIR64B:          return "MOVDIR64B";
+        case CPU_FEATURE_ENQCMD:             return "ENQCMD";
+        case CPU_FEATURE_AVX512_4VNNIW:      return "AVX512_4VNNIW";
+        case CPU_FEATURE_AVX512_4FMAPS:      return "AVX512_4FMAPS";
+        case CPU_FEATURE_FSRM:               return "FSRM";
+        case CPU_FEATURE_UINTR:              return "UINTR";
+        case CPU_FEATURE_AVX512VP2INTERSECT: return "AVX512VP2INTERSECT";
+        case CPU_FEATURE_MD_CLEAR:           return "MD-CLEAR";
+        case CPU_FEATURE_SERIALIZE:          return "SERIALIZE";
+        case CPU_FEATURE_HYBRID:             return "HYBRID";
+        case CPU_FEATURE_TSXLDTRK:           return "TSXLDTRK";
+        case CPU_FEATURE_CET_IBT:            return "CET-IBT";
+        case CPU_FEATURE_AMX_BF16:           return "AMX-BF16";
+        case CPU_FEATURE_AVX512FP16:         return "AVX512-FP16";
+        case CPU_FEATURE_AMX_TILE:           return "AMX-TILE";
+        case CPU_FEATURE_AMX_INT8:           return "AMX-INT8";
+        case CPU_FEATURE_AVX_VNNI:           return "AVX-VNNI";
+        case CPU_FEATURE_AVX512BF16:         return "AVX512-BF16";
+        case CPU_FEATURE_CMPCCXADD:          return "CMPCCXADD";
+        case CPU_FEATURE_FZLRM:              return "FZLRM";
+        case CPU_FEATURE_FSRS:               return "FSRS";
+        case CPU_FEATURE_FSRCS:              return "FSRCS";
+        case CPU_FEATURE_AMX_FP16:           return "AMX-FP16";
+        case CPU_FEATURE_HRESET:             return "HRESET";
+        case CPU_FEATURE_AVX_IFMA:           return "AVX-IFMA";
+        case CPU_FEATURE_LAM:                return "LAM";
+        case CPU_FEATURE_XSAVEOPT:           return "XSAVEOPT";
+        case CPU_FEATURE_XSAVEC:             return "XSAVEC";
+        case CPU_FEATURE_XSAVES:             return "XSAVES";
+        case CPU_FEATURE_LAHF_LM:            return "LAHF-LM";
+        case CPU_FEATURE_SVM:                return "SVM";
+        case CPU_FEATURE_LZCNT:              return "LZCNT";
+        case CPU_FEATURE_MISALIGNSSE:        return "MISALIGNSSE";
+        case CPU_FEATURE_PREFETCHW:          return "PREFETCHW";
+        case CPU_FEATURE_XOP:                return "XOP";
+        case CPU_FEATURE_TBM:                return "TBM";
+        case CPU_FEATURE_TOPOEXT:            return "TOPOEXT";
+        case CPU_FEATURE_PERFCTR_CORE:       return "PERFCTR_CORE";
+        case CPU_FEATURE_MONITORX:           return "MONITORX";
+        case CPU_FEATURE_SYSCALL:            return "SYSCALL";
+        case CPU_FEATURE_MMXEXT:             return "MMXEXT";
+        case CPU_FEATURE_PDPE1GB:            return "PDPE1GB";
+        case CPU_FEATURE_RDTSCP:             return "RDTSCP";
+        case CPU_FEATURE_LM:                 return "LM";
+        case CPU_FEATURE_INVARIANT_TSC:      return "Invariant TSC";
+        case CPU_FEATURE_CPB:                return "CPB";
+        case CPU_FEATURE_CLZERO:             return "CLZERO";
+        case CPU_FEATURE_INVLPGB:            return "INVLPGB";
+        case CPU_FEATURE_RDPRU:              return "RDPRU";
+        case CPU_FEATURE_MCOMMIT:            return "MCOMMIT";
+        case CPU_FEATURE_WBNOINVD:           return "WBNOINVD";
+        default:                             return "Unknown";
     }// clang-format on
 }
 
 void cpu_reset_state() {
+    LCPU_INSTRUMENT(CPU_STATS_API_RESET_STATE);
     g_is_initialized = LCPU_FALSE;
-    g_enabled_features = CPU_FEATURE_NONE;
+    g_enabled_features = (CPUFeatureSet){0};
+    LCPU_MEMSET(g_cores, 0, sizeof(g_cores));
+    LCPU_MEMSET(&g_overflow_core, 0, sizeof(CoreState));
+    cpu_atomic_store32(&g_num_cores, 0, CPU_MEMORY_ORDER_RELAXED);
+    cpu_atomic_store32(&g_num_usermode_cores, 0, CPU_MEMORY_ORDER_RELAXED);
+    cpu_atomic_store32(&g_info_state, INFO_STATE_INVALID, CPU_MEMORY_ORDER_RELEASE);
+    lcpu_popcnt_init(&g_enabled_features);
+    lcpu_memory_init(&g_enabled_features);
+    lcpu_xstate_init(&g_enabled_features);
 }
 
-void cpu_init(CPUFeature features) {
+void cpu_init(CPUFeatureSet features) {
+    LCPU_INSTRUMENT(CPU_STATS_API_INIT);
+    lcpu_get_info();// Take the CPUID snapshot before touching any control registers
+    cpu_ticket_lock_acquire(&g_init_lock);
     if(g_is_initialized) {
-        return;// Ignore all calls
-    }
-    CALL_IF_ENABLED(features, CPU_FEATURE_FXSR, init_fxsr);
-    CALL_IF_ENABLED(features, CPU_FEATURE_XSAVE, init_xsave);
-    CALL_IF_ENABLED(features, CPU_FEATURE_X87, init_fpu);
-    CALL_IF_ENABLED(features, CPU_FEATURE_X87 | CPU_FEATURE_MMX, init_fpu);
-    CALL_IF_ENABLED(features, CPU_FEATURE_XSAVE | CPU_FEATURE_FXSR | CPU_FEATURE_MMX | CPU_FEATURE_SSE, init_sse);
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSE | CPU_FEATURE_SSE2, init_sse);
-#ifdef CPU_64_BIT
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSE2 | CPU_FEATURE_SSE3, init_sse);
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSE3 | CPU_FEATURE_SSSE3, init_sse);
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSSE3 | CPU_FEATURE_SSE4_1, init_sse);
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSE4_1 | CPU_FEATURE_SSE4_2, init_sse);
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSE4_2 | CPU_FEATURE_SSE4A, init_sse);
-    CALL_IF_ENABLED(features, CPU_FEATURE_SSE4_2 | CPU_FEATURE_AVX, init_avx);
-    CALL_IF_ENABLED(features, CPU_FEATURE_AVX | CPU_FEATURE_AVX2, init_avx);
-    CALL_IF_ENABLED(features, CPU_FEATURE_AVX2 | CPU_FEATURE_AVX512, init_avx);
-#endif
+        cpu_ticket_lock_release(&g_init_lock);
+        cpu_init_ap();// The configuration was already chosen, only bring up this processor
+        return;
+    }
+    // TSC_AUX may not belong to this processor yet, so key the state on the APIC ID itself
+    CoreState* core = get_core_state(cpu_get_apic_id(), LCPU_TRUE);
+    init_core(&features);
+    verify_features(&features);
+    lcpu_popcnt_init(&features);// Resolve the bulk popcount kernels once
+    lcpu_memory_init(&features);// Resolve the memory kernels once
+    lcpu_xstate_init(&features);// Size the save area for the final XCR0
     g_enabled_features = features;
-    g_is_initialized = LCPU_TRUE;
+    core->is_initialized = LCPU_TRUE;
+    cpu_atomic_store8(&g_is_initialized, LCPU_TRUE, CPU_MEMORY_ORDER_RELEASE);
+    cpu_ticket_lock_release(&g_init_lock);
+}
+
+cpu_bool cpu_init_ap() {
+    LCPU_INSTRUMENT(CPU_STATS_API_INIT_AP);
+    if(!cpu_atomic_load8(&g_is_initialized, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return LCPU_FALSE;
+    }
+    CoreState* core = get_core_state(cpu_get_apic_id(), LCPU_TRUE);
+    if(!core->is_initialized) {
+        init_core(&g_enabled_features);
+        core->is_initialized = LCPU_TRUE;
+    }
+    return LCPU_TRUE;
 }
 
 cpu_bool cpu_is_initialized() {
-    return g_is_initialized;
+    LCPU_INSTRUMENT(CPU_STATS_API_IS_INITIALIZED);
+    if(!cpu_atomic_load8(&g_is_initialized, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return LCPU_FALSE;
+    }
+    const CoreState* core = get_core_state(cpu_current_id(), LCPU_FALSE);
+    return core != nullptr && core->is_initialized;
 }
 
 void cpu_set_exception_handler(CPUExceptionHandler handler) {
+    LCPU_INSTRUMENT(CPU_STATS_API_SET_EXCEPTION_HANDLER);
     g_exception_handler = handler;
 }
 
 CPUExceptionHandler cpu_get_exception_handler() {
+    LCPU_INSTRUMENT(CPU_STATS_API_GET_EXCEPTION_HANDLER);
     return g_exception_handler;
 }
 
 void cpu_hint_spin() {
+    LCPU_INSTRUMENT(CPU_STATS_API_HINT_SPIN);
     _assemble(_ins(), _outs(), _clobs(), _emitI(pause));
 }
 
-_Noreturn void cpu_halt() {
-    while(true) {
-        cpu_hint_spin();
-    }
-}
-
 void cpu_enter_usermode() {
-    g_is_usermode = LCPU_TRUE;
+    LCPU_INSTRUMENT(CPU_STATS_API_ENTER_USERMODE);
+    CoreState* core = get_core_state(cpu_current_id(), LCPU_TRUE);
+    if(!cpu_atomic_exchange8(&core->is_usermode, LCPU_TRUE, CPU_MEMORY_ORDER_ACQ_REL)) {
+        cpu_atomic_fetch_add32(&g_num_usermode_cores, 1, CPU_MEMORY_ORDER_RELEASE);
+    }
+    lcpu_xstate_init(&g_enabled_features);// XSAVES is privileged
 }
 
 cpu_bool cpu_is_usermode() {
-    return g_is_usermode;
-}
-
-static cpu_usize kernigham_popcnt32(cpu_u32 value) {
-    cpu_usize count = 0;
-    while(value != 0) {
-        value &= (value - 1);
-        ++count;
+    LCPU_INSTRUMENT(CPU_STATS_API_IS_USERMODE);
+    // Most callers only guard privileged instructions, so answer without identifying the processor if possible
+    const cpu_u32 num_usermode_cores = cpu_atomic_load32(&g_num_usermode_cores, CPU_MEMORY_ORDER_ACQUIRE);
+    if(num_usermode_cores == 0) {
+        return LCPU_FALSE;
     }
-    return count;
+    if(num_usermode_cores >= cpu_atomic_load32(&g_num_cores, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return LCPU_TRUE;// Processors without state are treated like the rest, which errs on the safe side
+    }
+    const CoreState* core = get_core_state(cpu_current_id(), LCPU_FALSE);
+    return core != nullptr && core->is_usermode;
 }
 
 cpu_usize cpu_popcnt16(cpu_u16 value) {
-    if((cpu_get_features() & CPU_FEATURE_POPCNT) != 0) {
+    LCPU_INSTRUMENT(CPU_STATS_API_POPCNT16);
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_POPCNT)) {
         cpu_u16 result = 0;
         _assemble(// clang-format off
             _ins(_in(value)),
@@ -435,11 +1189,12 @@ cpu_usize cpu_popcnt16(cpu_u16 value) {
         );// clang-format on
         return (cpu_usize) result;
     }
-    return kernigham_popcnt32((cpu_u32) value);
+    return popcnt32_impl((cpu_u32) value);
 }
 
 cpu_usize cpu_popcnt32(cpu_u32 value) {
-    if((cpu_get_features() & CPU_FEATURE_POPCNT) != 0) {
+    LCPU_INSTRUMENT(CPU_STATS_API_POPCNT32);
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_POPCNT)) {
         cpu_u32 result = 0;
         _assemble(// clang-format off
             _ins(_in(value)),
@@ -451,12 +1206,13 @@ cpu_usize cpu_popcnt32(cpu_u32 value) {
         );// clang-format on
         return (cpu_usize) result;
     }
-    return kernigham_popcnt32((cpu_u32) value);
+    return popcnt32_impl((cpu_u32) value);
 }
 
 cpu_usize cpu_popcnt64(cpu_u64 value) {
+    LCPU_INSTRUMENT(CPU_STATS_API_POPCNT64);
 #ifdef CPU_64_BIT
-    if((cpu_get_features() & CPU_FEATURE_POPCNT) != 0) {
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_POPCNT)) {
         cpu_u64 result = 0;
         _assemble(// clang-format off
             _ins(_in(value)),
@@ -469,12 +1225,7 @@ cpu_usize cpu_popcnt64(cpu_u64 value) {
         return (cpu_usize) result;
     }
 #endif
-    cpu_usize count = 0;
-    while(value != 0) {
-        value &= (value - 1);
-        ++count;
-    }
-    return count;
+    return popcnt64_impl(value);
 }
 
 #endif// CPU_X86
\ No newline at end of file
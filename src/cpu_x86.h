@@ -20,11 +20,15 @@
 
 #ifdef CPU_X86
 
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
 #include "cpu/cpu_types.h"
 
 typedef struct _CPUID_EBX_L6 {
-
+    cpu_u8 num_thermal_thresholds : 4;
+    cpu_u32 : 28;// Fill up to 32 bits
 } CPUID_EBX_L6;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L6) == 4, "Invalid structure size");
 
 typedef struct _CPUID_EBX_L7_0 {
     cpu_bool fsgsbase : 1;
@@ -99,8 +103,14 @@ typedef struct _CPUID_EDX_L1 {
 LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L1) == 4, "Invalid structure size");
 
 typedef struct _CPUID_EDX_L6 {
-
+    cpu_bool hw_feedback_perf : 1;
+    cpu_bool hw_feedback_efficiency : 1;
+    cpu_u8 : 6;
+    cpu_u8 hw_feedback_size : 4;// Size of the feedback structure in 4 KiB pages minus one
+    cpu_u8 : 4;
+    cpu_u16 hw_feedback_index : 16;// Row of this logical processor in the feedback structure
 } CPUID_EDX_L6;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L6) == 4, "Invalid structure size");
 
 typedef struct _CPUID_EDX_L7_0 {
     cpu_bool : 1;
@@ -124,6 +134,8 @@ typedef struct _CPUID_EDX_L7_0 {
     cpu_bool lbr : 1;
     cpu_bool cet_ibt : 1;
     cpu_bool : 1;
+    cpu_bool amx_bf16 : 1;
+    cpu_bool avx512_fp16 : 1;
     cpu_bool amx_tile : 1;
     cpu_bool amx_int8 : 1;
     cpu_bool spec_ctrl : 1;
@@ -143,6 +155,24 @@ typedef struct _CPUID_EDX_L7_2 {
 
 } CPUID_EDX_L7_2;
 
+typedef struct _CPUID_EDX_L80000007 {
+    cpu_bool ts : 1;
+    cpu_bool fid : 1;
+    cpu_bool vid : 1;
+    cpu_bool ttp : 1;
+    cpu_bool tm : 1;
+    cpu_bool : 1;
+    cpu_bool step_100mhz : 1;
+    cpu_bool hw_pstate : 1;
+    cpu_bool invariant_tsc : 1;
+    cpu_bool cpb : 1;
+    cpu_bool eff_freq_ro : 1;
+    cpu_bool proc_feedback_interface : 1;
+    cpu_bool proc_power_reporting : 1;
+    cpu_u32 : 19;// Fill up to 32 bits
+} CPUID_EDX_L80000007;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L80000007) == 4, "Invalid structure size");
+
 typedef struct _CPUID_EDX_L80000001 {
     cpu_bool fpu : 1;
     cpu_bool vme : 1;
@@ -179,6 +209,35 @@ typedef struct _CPUID_EDX_L80000001 {
 } CPUID_EDX_L80000001;
 LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L80000001) == 4, "Invalid structure size");
 
+typedef struct _CPUID_EBX_L80000008 {
+    cpu_bool clzero : 1;
+    cpu_bool inst_ret_cnt_msr : 1;
+    cpu_bool rstr_fp_err_ptrs : 1;
+    cpu_bool invlpgb : 1;
+    cpu_bool rdpru : 1;
+    cpu_bool : 1;
+    cpu_bool mbe : 1;
+    cpu_bool : 1;
+    cpu_bool mcommit : 1;
+    cpu_bool wbnoinvd : 1;
+    cpu_u8 : 2;
+    cpu_bool ibpb : 1;
+    cpu_bool int_wbinvd : 1;
+    cpu_bool ibrs : 1;
+    cpu_bool stibp : 1;
+    cpu_u8 : 7;
+    cpu_bool ppin : 1;
+    cpu_bool ssbd : 1;
+    cpu_bool virt_ssbd : 1;
+    cpu_bool ssb_no : 1;
+    cpu_bool cppc : 1;
+    cpu_bool psfd : 1;
+    cpu_bool btc_no : 1;
+    cpu_bool ibpb_ret : 1;
+    cpu_bool : 1;
+} CPUID_EBX_L80000008;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L80000008) == 4, "Invalid structure size");
+
 typedef struct _CPUID_ECX_L1 {
     cpu_bool sse3 : 1;
     cpu_bool pclmulqdq : 1;
@@ -216,8 +275,14 @@ typedef struct _CPUID_ECX_L1 {
 LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L1) == 4, "Invalid structure size");
 
 typedef struct _CPUID_ECX_L6 {
-
+    cpu_bool aperf_mperf : 1;// Hardware coordination feedback
+    cpu_u8 : 2;
+    cpu_bool energy_perf_bias : 1;
+    cpu_u8 : 4;
+    cpu_u8 num_itd_classes : 8;
+    cpu_u16 : 16;// Fill up to 32 bits
 } CPUID_ECX_L6;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L6) == 4, "Invalid structure size");
 
 typedef struct _CPUID_ECX_L7_0 {
     cpu_bool prefetchwt1 : 1;
@@ -320,37 +385,366 @@ typedef struct _CPUID_EAX_L6 {
 } CPUID_EAX_L6;
 LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_L6) == 4, "Invalid structure size");
 
+typedef struct _CPUID_EAX_L7_1 {
+    cpu_u8 : 4;
+    cpu_bool avx_vnni : 1;
+    cpu_bool avx512_bf16 : 1;
+    cpu_bool lass : 1;
+    cpu_bool cmpccxadd : 1;
+    cpu_bool arch_perfmon_ext : 1;
+    cpu_bool : 1;
+    cpu_bool fzlrm : 1;
+    cpu_bool fsrs : 1;
+    cpu_bool fsrcs : 1;
+    cpu_u32 : 4;
+    cpu_bool fred : 1;
+    cpu_bool lkgs : 1;
+    cpu_bool wrmsrns : 1;
+    cpu_bool : 1;
+    cpu_bool amx_fp16 : 1;
+    cpu_bool hreset : 1;
+    cpu_bool avx_ifma : 1;
+    cpu_u8 : 2;
+    cpu_bool lam : 1;
+    cpu_bool msrlist : 1;
+    cpu_u8 : 4;// Fill up to 32 bits
+} CPUID_EAX_L7_1;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_L7_1) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EBX_L1 {
+    cpu_u32 brand_index : 8;
+    cpu_u32 clflush_size : 8;   // In units of 8 bytes
+    cpu_u32 max_logical_ids : 8;// Only valid if HTT is set
+    cpu_u32 initial_apic_id : 8;
+} CPUID_EBX_L1;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L1) == 4, "Invalid structure size");
+
+// Deterministic cache parameters, leaf 8000001D (AMD) shares the layout of leaf 4 (Intel)
+typedef struct _CPUID_EAX_L4 {
+    cpu_u32 type : 5;// 0 = no more caches, 1 = data, 2 = instruction, 3 = unified
+    cpu_u32 level : 3;
+    cpu_bool self_initializing : 1;
+    cpu_bool fully_associative : 1;
+    cpu_u32 : 4;
+    cpu_u32 max_sharing_ids : 12;// Minus one
+    cpu_u32 max_core_ids : 6;    // Minus one (Intel only)
+} CPUID_EAX_L4;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_L4) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EBX_L4 {
+    cpu_u32 line_size : 12; // Minus one
+    cpu_u32 partitions : 10;// Minus one
+    cpu_u32 ways : 10;      // Minus one
+} CPUID_EBX_L4;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L4) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EDX_L4 {
+    cpu_bool wbinvd_no_inner : 1;// WBINVD does not invalidate lower level caches sharing this cache
+    cpu_bool inclusive : 1;
+    cpu_bool complex_indexing : 1;// Intel only
+    cpu_u32 : 29;                 // Fill up to 32 bits
+} CPUID_EDX_L4;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L4) == 4, "Invalid structure size");
+
+// L1 data cache, the L1 instruction cache in EDX uses the same layout (AMD only)
+typedef struct _CPUID_ECX_L80000005 {
+    cpu_u32 line_size : 8;
+    cpu_u32 lines_per_tag : 8;
+    cpu_u32 associativity : 8;// 0xFF = fully associative
+    cpu_u32 size : 8;         // In KiB
+} CPUID_ECX_L80000005;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L80000005) == 4, "Invalid structure size");
+
+typedef CPUID_ECX_L80000005 CPUID_EDX_L80000005;
+
+// L2 cache
+typedef struct _CPUID_ECX_L80000006 {
+    cpu_u32 line_size : 8;
+    cpu_u32 lines_per_tag : 4;
+    cpu_u32 associativity : 4;// Encoded, 0xF = fully associative
+    cpu_u32 size : 16;        // In KiB
+} CPUID_ECX_L80000006;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L80000006) == 4, "Invalid structure size");
+
+// L3 cache (AMD only)
+typedef struct _CPUID_EDX_L80000006 {
+    cpu_u32 line_size : 8;
+    cpu_u32 lines_per_tag : 4;
+    cpu_u32 associativity : 4;// Encoded like the L2 associativity
+    cpu_u32 : 2;
+    cpu_u32 size : 14;// In units of 512 KiB
+} CPUID_EDX_L80000006;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L80000006) == 4, "Invalid structure size");
+
+// Extended topology enumeration, leaf 1F shares the layout of leaf B, EDX holds the x2APIC ID
+typedef struct _CPUID_EAX_LB {
+    cpu_u32 shift : 5;// Right-shift of the x2APIC ID to get the ID of the next level
+    cpu_u32 : 27;     // Fill up to 32 bits
+} CPUID_EAX_LB;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_LB) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EBX_LB {
+    cpu_u32 num_logical : 16;// Logical processors per instance of the next level
+    cpu_u32 : 16;            // Fill up to 32 bits
+} CPUID_EBX_LB;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_LB) == 4, "Invalid structure size");
+
+typedef struct _CPUID_ECX_LB {
+    cpu_u32 level : 8;
+    cpu_u32 type : 8;// 0 = invalid, 1 = SMT, 2 = core, 3 = module, 4 = tile, 5 = die, 6 = die group
+    cpu_u32 : 16;    // Fill up to 32 bits
+} CPUID_ECX_LB;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_LB) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EAX_LD_1 {
+    cpu_bool xsaveopt : 1;
+    cpu_bool xsavec : 1;
+    cpu_bool xgetbv_ecx1 : 1;
+    cpu_bool xsaves : 1;
+    cpu_bool xfd : 1;
+    cpu_u32 : 27;// Fill up to 32 bits
+} CPUID_EAX_LD_1;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_LD_1) == 4, "Invalid structure size");
+
+// Sub-leaves 2 to 62 describe a single state component, EAX holds its size and EBX its standard offset
+typedef struct _CPUID_ECX_LD {
+    cpu_bool supervisor : 1;// Managed through IA32_XSS instead of XCR0
+    cpu_bool aligned : 1;   // 64-byte aligned in the compacted format
+    cpu_bool xfd : 1;
+    cpu_u32 : 29;// Fill up to 32 bits
+} CPUID_ECX_LD;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_LD) == 4, "Invalid structure size");
+
+// AMD only, EAX holds the extended APIC ID
+typedef struct _CPUID_EBX_L8000001E {
+    cpu_u32 core_id : 8;
+    cpu_u32 threads_per_core : 8;// Minus one
+    cpu_u32 : 16;                // Fill up to 32 bits
+} CPUID_EBX_L8000001E;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L8000001E) == 4, "Invalid structure size");
+
+typedef struct _CPUID_ECX_L8000001E {
+    cpu_u32 node_id : 8;
+    cpu_u32 nodes_per_package : 3;// Minus one
+    cpu_u32 : 21;                 // Fill up to 32 bits
+} CPUID_ECX_L8000001E;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L8000001E) == 4, "Invalid structure size");
+
+typedef struct _CPUID_ECX_L80000008 {
+    cpu_u32 num_threads : 8;// Minus one
+    cpu_u32 : 4;
+    cpu_u32 apic_id_size : 4;// Number of APIC ID bits identifying the core within the package
+    cpu_u32 perf_tsc_size : 2;
+    cpu_u32 : 14;// Fill up to 32 bits
+} CPUID_ECX_L80000008;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L80000008) == 4, "Invalid structure size");
+
+// MONITOR/MWAIT enumeration
+typedef struct _CPUID_EAX_L5 {
+    cpu_u32 min_monitor_size : 16;// Smallest monitor line size in bytes
+    cpu_u32 : 16;                 // Fill up to 32 bits
+} CPUID_EAX_L5;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_L5) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EBX_L5 {
+    cpu_u32 max_monitor_size : 16;// Largest monitor line size in bytes
+    cpu_u32 : 16;                 // Fill up to 32 bits
+} CPUID_EBX_L5;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L5) == 4, "Invalid structure size");
+
+typedef struct _CPUID_ECX_L5 {
+    cpu_bool extensions : 1;      // EDX enumerates the sub-states
+    cpu_bool interrupt_break : 1; // Interrupts break MWAIT even when masked
+    cpu_bool monitorless_mwait : 1;
+    cpu_u32 : 29;// Fill up to 32 bits
+} CPUID_ECX_L5;
+LCPU_STATIC_ASSERT(sizeof(CPUID_ECX_L5) == 4, "Invalid structure size");
+
+// Number of MWAIT sub-states per C-state, C0 in the lowest nibble
+typedef struct _CPUID_EDX_L5 {
+    cpu_u32 c0 : 4;
+    cpu_u32 c1 : 4;
+    cpu_u32 c2 : 4;
+    cpu_u32 c3 : 4;
+    cpu_u32 c4 : 4;
+    cpu_u32 c5 : 4;
+    cpu_u32 c6 : 4;
+    cpu_u32 c7 : 4;
+} CPUID_EDX_L5;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_L5) == 4, "Invalid structure size");
+
+// Architectural performance monitoring
+typedef struct _CPUID_EAX_LA {
+    cpu_u32 version : 8;
+    cpu_u32 num_counters : 8;// General purpose counters per logical processor
+    cpu_u32 counter_width : 8;
+    cpu_u32 num_events : 8;// Number of valid bits in EBX
+} CPUID_EAX_LA;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_LA) == 4, "Invalid structure size");
+
+// A set bit means the architectural event is NOT available
+typedef struct _CPUID_EBX_LA {
+    cpu_bool no_core_cycles : 1;
+    cpu_bool no_instructions_retired : 1;
+    cpu_bool no_reference_cycles : 1;
+    cpu_bool no_llc_references : 1;
+    cpu_bool no_llc_misses : 1;
+    cpu_bool no_branch_instructions_retired : 1;
+    cpu_bool no_branch_mispredicts_retired : 1;
+    cpu_bool no_topdown_slots : 1;
+    cpu_u32 : 24;// Fill up to 32 bits
+} CPUID_EBX_LA;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_LA) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EDX_LA {
+    cpu_u32 num_fixed_counters : 5;// Only valid from version 2
+    cpu_u32 fixed_counter_width : 8;
+    cpu_u32 : 2;
+    cpu_bool anythread_deprecated : 1;
+    cpu_u32 : 16;// Fill up to 32 bits
+} CPUID_EDX_LA;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EDX_LA) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EAX_L80000008 {
+    cpu_u32 physical_address_size : 8;// MAXPHYADDR in bits
+    cpu_u32 linear_address_size : 8;
+    cpu_u32 guest_physical_address_size : 8;// 0 if the same as physical_address_size
+    cpu_u32 : 8;                            // Fill up to 32 bits
+} CPUID_EAX_L80000008;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_L80000008) == 4, "Invalid structure size");
+
+// AMD extended performance monitoring
+typedef struct _CPUID_EAX_L80000022 {
+    cpu_bool perfmon_v2 : 1;// Global control and status MSRs
+    cpu_bool lbr_stack : 1;
+    cpu_bool lbr_pmc_freeze : 1;
+    cpu_u32 : 29;// Fill up to 32 bits
+} CPUID_EAX_L80000022;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EAX_L80000022) == 4, "Invalid structure size");
+
+typedef struct _CPUID_EBX_L80000022 {
+    cpu_u32 num_core_counters : 4;
+    cpu_u32 lbr_stack_size : 6;
+    cpu_u32 num_nb_counters : 6;
+    cpu_u32 num_umc_counters : 6;
+    cpu_u32 : 10;// Fill up to 32 bits
+} CPUID_EBX_L80000022;
+LCPU_STATIC_ASSERT(sizeof(CPUID_EBX_L80000022) == 4, "Invalid structure size");
+
 typedef struct _CPUID {
     union {
         cpu_u32 value;
-        CPUID_EBX_L6 leaf6;    // Leaf 6
-        CPUID_EBX_L7_0 leaf7_0;// Leaf 7:0
+        CPUID_EBX_L1 leaf1;              // Leaf 1
+        CPUID_EBX_L4 leaf4;              // Leaf 4
+        CPUID_EBX_L5 leaf5;              // Leaf 5
+        CPUID_EBX_L6 leaf6;              // Leaf 6
+        CPUID_EBX_L7_0 leaf7_0;          // Leaf 7:0
+        CPUID_EBX_LA leafA;              // Leaf A
+        CPUID_EBX_LB leafB;              // Leaf B
+        CPUID_EBX_LB leaf1F;             // Leaf 1F
+        CPUID_EBX_L80000008 leaf80000008;// Leaf 80000008 (AMD only)
+        CPUID_EBX_L4 leaf8000001D;       // Leaf 8000001D (AMD only)
+        CPUID_EBX_L8000001E leaf8000001E;// Leaf 8000001E (AMD only)
+        CPUID_EBX_L80000022 leaf80000022;// Leaf 80000022 (AMD only)
     } ebx;
     union {
         cpu_u32 value;
         CPUID_EDX_L1 leaf1;              // Leaf 1
+        CPUID_EDX_L4 leaf4;              // Leaf 4
+        CPUID_EDX_L5 leaf5;              // Leaf 5
         CPUID_EDX_L6 leaf6;              // Leaf 6
         CPUID_EDX_L7_0 leaf7_0;          // Leaf 7:0
         CPUID_EDX_L7_1 leaf7_1;          // Leaf 7:1
         CPUID_EDX_L7_2 leaf7_2;          // Leaf 7:2
+        CPUID_EDX_LA leafA;              // Leaf A
         CPUID_EDX_L80000001 leaf80000001;// Leaf 80000001 (AMD only)
+        CPUID_EDX_L80000005 leaf80000005;// Leaf 80000005 (AMD only)
+        CPUID_EDX_L80000006 leaf80000006;// Leaf 80000006 (AMD only)
+        CPUID_EDX_L80000007 leaf80000007;// Leaf 80000007
+        CPUID_EDX_L4 leaf8000001D;       // Leaf 8000001D (AMD only)
     } edx;
     union {
         cpu_u32 value;
         CPUID_ECX_L1 leaf1;              // Leaf 1
+        CPUID_ECX_L5 leaf5;              // Leaf 5
         CPUID_ECX_L6 leaf6;              // Leaf 6
         CPUID_ECX_L7_0 leaf7_0;          // Leaf 7:0
         CPUID_ECX_L7_1 leaf7_1;          // Leaf 7:1
+        CPUID_ECX_LB leafB;              // Leaf B
+        CPUID_ECX_LB leaf1F;             // Leaf 1F
+        CPUID_ECX_LD leafD;              // Leaf D:2 to D:62
         CPUID_ECX_L80000001 leaf80000001;// Leaf 80000001 (AMD only)
+        CPUID_ECX_L80000005 leaf80000005;// Leaf 80000005 (AMD only)
+        CPUID_ECX_L80000006 leaf80000006;// Leaf 80000006
+        CPUID_ECX_L80000008 leaf80000008;// Leaf 80000008 (AMD only)
+        CPUID_ECX_L8000001E leaf8000001E;// Leaf 8000001E (AMD only)
     } ecx;
     union {
         cpu_u32 value;
-        CPUID_EAX_L6 leaf6;// Leaf 6
+        CPUID_EAX_L4 leaf4;              // Leaf 4
+        CPUID_EAX_L5 leaf5;              // Leaf 5
+        CPUID_EAX_L6 leaf6;              // Leaf 6
+        CPUID_EAX_L7_1 leaf7_1;          // Leaf 7:1
+        CPUID_EAX_LA leafA;              // Leaf A
+        CPUID_EAX_LB leafB;              // Leaf B
+        CPUID_EAX_LB leaf1F;             // Leaf 1F
+        CPUID_EAX_LD_1 leafD_1;          // Leaf D:1
+        CPUID_EAX_L80000008 leaf80000008;// Leaf 80000008
+        CPUID_EAX_L4 leaf8000001D;       // Leaf 8000001D (AMD only)
+        CPUID_EAX_L80000022 leaf80000022;// Leaf 80000022 (AMD only)
     } eax;
 } CPUID;
 
 LCPU_STATIC_ASSERT(sizeof(CPUID) <= (sizeof(void*) << 2), "CPUID structure is too large");
 
+// Maximum number of distinct leaf/sub-leaf pairs held by the CPUID snapshot
+#define LCPU_CPUID_CACHE_SIZE 64
+
+/**
+ * Describes how APIC IDs are split into the IDs of the individual topology levels.
+ * Each level's ID occupies the bits from its own shift up to the shift of the next level.
+ * Levels which aren't reported occupy no bits and span the entire next level.
+ */
+typedef struct _CPUTopologyLayout {
+    cpu_u32 apic_id_leaf;// The CPUID leaf the APIC IDs matching this layout are read from
+    cpu_u32 core_shift;
+    cpu_u32 module_shift;
+    cpu_u32 die_shift;
+    cpu_u32 package_shift;
+    cpu_u32 threads_per_core;
+    cpu_u32 threads_per_module;
+    cpu_u32 threads_per_die;
+    cpu_u32 threads_per_package;
+} CPUTopologyLayout;
+
+typedef struct _CPUIDCacheEntry {
+    cpu_u32 leaf;
+    cpu_u32 sub_leaf;
+    CPUID value;
+} CPUIDCacheEntry;
+
+/**
+ * One-time snapshot of everything libcpu reads from CPUID.
+ * Filled lazily on first use or by cpu_init() and invalidated by cpu_reset_state(),
+ * so none of the query functions has to execute the serializing CPUID instruction again.
+ */
+typedef struct _CPUInfo {
+    cpu_u32 max_leaf;    // Highest supported basic leaf
+    cpu_u32 max_ext_leaf;// Highest supported extended leaf (0x8000XXXX)
+    CPUVendor vendor;
+    CPUVendor hypervisor;// CPU_VENDOR_UNKNOWN on bare metal
+    cpu_u32 max_hv_leaf; // Highest supported hypervisor leaf (0x4000XXXX), 0 on bare metal
+    CPUFeatureSet features;
+    cpu_usize num_leaves;
+    CPUIDCacheEntry leaves[LCPU_CPUID_CACHE_SIZE];
+    cpu_bool is_cache_info_valid;// Cache info is decoded on first use
+    CPUCacheInfo cache_info;
+    cpu_bool is_topology_valid;// Topology layout is decoded on first use
+    CPUTopologyLayout topology;
+    cpu_bool is_mwait_info_valid;// MWAIT capabilities are decoded on first use
+    CPUMwaitInfo mwait_info;
+} CPUInfo;
+
 typedef struct _CPU_CR0 {
     cpu_bool pe : 1;
     cpu_bool mp : 1;
@@ -441,7 +835,7 @@ typedef struct _CPU_XCR0 {
     cpu_bool avx : 1;
     cpu_bool bndreg : 1;
     cpu_bool bndcsr : 1;
-    cpu_bool optmask : 1;
+    cpu_bool opmask : 1;
     cpu_bool zmm_hi256 : 1;
     cpu_bool hi16_zmm : 1;
     cpu_bool pt : 1;
@@ -464,4 +858,80 @@ typedef struct _CPU_XCR0 {
 } CPU_XCR0;
 LCPU_STATIC_ASSERT(sizeof(CPU_XCR0) == sizeof(void*), "Invalid structure size");
 
+// Internal functions shared between the x86 translation units
+
+/**
+ * @return The CPUID snapshot of the current processor, enumerated on first use.
+ */
+CPUInfo* lcpu_get_info();
+
+/**
+ * Retrieve the given CPUID leaf from the snapshot, executing CPUID only for leaves not seen before.
+ */
+void lcpu_cpuid(cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value);
+
+/**
+ * Execute CPUID on the current processor, bypassing the snapshot.
+ * Required for values which differ between logical processors, like APIC IDs.
+ */
+void lcpu_cpuid_uncached(cpu_u32 leaf, cpu_u32 sub_leaf, CPUID* value);
+
+/**
+ * Read the XCR0 register of the current processor. Requires CR4.OSXSAVE to be set.
+ */
+void lcpu_get_xcr0(CPU_XCR0* value);
+
+/**
+ * Read the CR0 register of the current processor.
+ */
+void lcpu_get_cr0(CPU_CR0* value);
+
+/**
+ * Write the CR0 register of the current processor.
+ */
+void lcpu_set_cr0(const CPU_CR0* value);
+
+/**
+ * Read the CR4 register of the current processor.
+ */
+void lcpu_get_cr4(CPU_CR4* value);
+
+/**
+ * Write the CR4 register of the current processor.
+ */
+void lcpu_set_cr4(const CPU_CR4* value);
+
+/**
+ * Select the bulk popcount kernels for the given set of enabled features.
+ */
+void lcpu_popcnt_init(const CPUFeatureSet* features);
+
+/**
+ * Select the memcpy/memmove/memset kernels for the given set of enabled features.
+ * An empty set resets them to the stateless string instruction fallback.
+ */
+void lcpu_memory_init(const CPUFeatureSet* features);
+
+/**
+ * Select the extended state save instruction and size the save area
+ * for the given set of enabled features and the current XCR0.
+ */
+void lcpu_xstate_init(const CPUFeatureSet* features);
+
+/**
+ * @return The size of the largest data or unified cache in bytes, or 0 if unknown.
+ */
+cpu_usize lcpu_get_shared_cache_size();
+
+/**
+ * Serialize publishing lazily decoded parts of the CPUInfo snapshot.
+ * Decoding itself happens outside of the lock, so decoders may call into each other.
+ */
+void lcpu_decode_lock();
+
+/**
+ * Release the lock taken by lcpu_decode_lock.
+ */
+void lcpu_decode_unlock();
+
 #endif// CPU_X86
\ No newline at end of file
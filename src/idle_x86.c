@@ -0,0 +1,183 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define IDLE_MWAIT_HINT_C1 0x00
+#define IDLE_MWAIT_INTERRUPT_BREAK 0x01
+
+// NOLINTBEGIN
+alignas(64) static cpu_u8 g_monitor_line[64];// Never written, so only interrupts end MWAIT
+// NOLINTEND
+
+static void monitor(const volatile void* address) {
+    _assemble(// clang-format off
+        _ins(_in(address)),
+        _outs(),
+        _clobs(_sclob(ax), _clob(ecx), _clob(edx)),
+        _emitI(mov _var(address), _sreg(ax))
+        _emitI(xor _reg(ecx), _reg(ecx))
+        _emitI(xor _reg(edx), _reg(edx))
+        _emitI(monitor)
+    );// clang-format on
+}
+
+// STI only takes effect after the next instruction, so no interrupt is lost before entering MWAIT
+static void sti_mwait(cpu_u32 hint) {
+    _assemble(// clang-format off
+        _ins(_in(hint)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ecx), _clob(memory)),
+        _emitI(mov _var(hint), _reg(eax))
+        _emitI(xor _reg(ecx), _reg(ecx))
+        _emitI(sti)
+        _emitI(mwait)
+    );// clang-format on
+}
+
+static void mwait(cpu_u32 hint, cpu_u32 extensions) {
+    _assemble(// clang-format off
+        _ins(_in(hint), _in(extensions)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ecx), _clob(memory)),
+        _emitI(mov _var(hint), _reg(eax))
+        _emitI(mov _var(extensions), _reg(ecx))
+        _emitI(mwait)
+    );// clang-format on
+}
+
+static void sti_hlt() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(sti) _emitI(hlt));
+}
+
+typedef struct _WaitContext {
+    const volatile cpu_u64* address;
+    cpu_u64 expected;
+} WaitContext;
+
+static cpu_bool has_value_changed(void* context) {
+    const WaitContext* wait_context = (const WaitContext*) context;
+    return *wait_context->address != wait_context->expected;
+}
+
+const CPUMwaitInfo* cpu_get_mwait_info() {
+    CPUInfo* info = lcpu_get_info();
+    if(!cpu_feature_set_test(&info->features, CPU_FEATURE_MONITOR)) {
+        return nullptr;
+    }
+    if(cpu_atomic_load8(&info->is_mwait_info_valid, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return &info->mwait_info;
+    }
+    CPUMwaitInfo decoded = {0};
+    CPUMwaitInfo* mwait_info = &decoded;
+    CPUID value;
+    lcpu_cpuid(5, 0, &value);
+    mwait_info->min_monitor_size = value.eax.leaf5.min_monitor_size;
+    mwait_info->max_monitor_size = value.ebx.leaf5.max_monitor_size;
+    mwait_info->has_interrupt_break = value.ecx.leaf5.interrupt_break;
+    const cpu_u32 sub_states = value.ecx.leaf5.extensions ? value.edx.value : 0;
+    for(cpu_u32 index = 0; index < CPU_MWAIT_MAX_CSTATES; ++index) {
+        mwait_info->num_sub_states[index] = (cpu_u8) ((sub_states >> (index << 2)) & 0xF);
+    }
+    lcpu_decode_lock();
+    if(!info->is_mwait_info_valid) {
+        info->mwait_info = decoded;
+        cpu_atomic_store8(&info->is_mwait_info_valid, LCPU_TRUE, CPU_MEMORY_ORDER_RELEASE);
+    }
+    lcpu_decode_unlock();
+    return &info->mwait_info;
+}
+
+cpu_u32 cpu_get_mwait_hint(CPUIdleHint hint) {
+    const CPUMwaitInfo* mwait_info = cpu_get_mwait_info();
+    if(mwait_info == nullptr || hint == CPU_IDLE_HINT_SHALLOW) {
+        return IDLE_MWAIT_HINT_C1;
+    }
+    // EAX[7:4] holds the C-state minus one, EAX[3:0] the sub-state
+    for(cpu_u32 state = CPU_MWAIT_MAX_CSTATES - 1; state > 0; --state) {
+        const cpu_u32 num_sub_states = mwait_info->num_sub_states[state];
+        if(num_sub_states != 0) {
+            return ((state - 1) << 4) | (num_sub_states - 1);
+        }
+    }
+    return IDLE_MWAIT_HINT_C1;
+}
+
+_Noreturn void cpu_halt() {
+    if(cpu_is_usermode()) {
+        while(true) {
+            cpu_hint_spin();
+        }
+    }
+    // NMIs and SMIs still wake the processor, so keep halting
+    while(true) {
+        _assemble(_ins(), _outs(), _clobs(), _emitI(cli) _emitI(hlt));
+    }
+}
+
+void cpu_idle(CPUIdleHint hint) {
+    if(cpu_is_usermode()) {
+        cpu_hint_spin();
+        return;
+    }
+    if(cpu_get_mwait_info() == nullptr) {
+        sti_hlt();
+        return;
+    }
+    monitor(g_monitor_line);
+    sti_mwait(cpu_get_mwait_hint(hint));
+}
+
+cpu_bool cpu_wait_on_address(const volatile void* address, cpu_u64 expected, cpu_u64 deadline) {
+    const volatile cpu_u64* value = (const volatile cpu_u64*) address;
+    const CPUMwaitInfo* mwait_info = cpu_get_mwait_info();
+    const cpu_usize first_byte = (cpu_usize) address;
+    const cpu_usize last_byte = first_byte + sizeof(cpu_u64) - 1;
+    const cpu_usize line_size = mwait_info != nullptr ? mwait_info->max_monitor_size : 0;
+    if(cpu_is_usermode() || line_size == 0 || (first_byte / line_size) != (last_byte / line_size)) {
+        WaitContext context = {value, expected};
+        const cpu_u64 now = cpu_rdtsc();
+        cpu_u64 timeout = CPU_SPIN_FOREVER;
+        if(deadline != CPU_SPIN_FOREVER) {
+            timeout = deadline > now ? deadline - now : 0;
+        }
+        return cpu_spin_until(has_value_changed, &context, timeout, CPU_SPIN_LATENCY_LOW);
+    }
+    // Allows waking up on interrupts even when they are masked
+    const cpu_u32 extensions = mwait_info->has_interrupt_break ? IDLE_MWAIT_INTERRUPT_BREAK : 0;
+    while(*value == expected) {
+        if(cpu_rdtsc() >= deadline) {
+            return LCPU_FALSE;
+        }
+        // Arm the monitor before checking again, so a write in between can't be missed
+        monitor(address);
+        if(*value != expected) {
+            break;
+        }
+        mwait(IDLE_MWAIT_HINT_C1, extensions);
+    }
+    return LCPU_TRUE;
+}
+
+#endif// CPU_X86
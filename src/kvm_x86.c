@@ -0,0 +1,198 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define KVM_MSR_SYSTEM_TIME 0x12
+#define KVM_MSR_SYSTEM_TIME_NEW 0x4B564D01
+#define KVM_MSR_STEAL_TIME 0x4B564D03
+#define KVM_MSR_ENABLED 0x01
+
+#define KVM_HC_KICK_CPU 5
+#define KVM_STEAL_TIME_PREEMPTED 0x01
+#define KVM_FLAGS_IF 0x200// RFLAGS.IF
+
+LCPU_STATIC_ASSERT(sizeof(CPUKVMPVClock) == 32, "Invalid structure size");
+LCPU_STATIC_ASSERT(sizeof(CPUKVMStealTime) == 64, "Invalid structure size");
+
+static cpu_usize get_flags() {
+    cpu_usize flags = 0;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_out(flags)),
+        _clobs(),
+        _emitI(pushf)
+        _emitI(pop _var(flags))
+    );// clang-format on
+    return flags;
+}
+
+static void cli() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(cli));
+}
+
+static void sti() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(sti));
+}
+
+static void hlt() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(hlt));
+}
+
+// STI only takes effect after the next instruction, so a kick can't slip in before HLT
+static void sti_hlt() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(sti) _emitI(hlt));
+}
+
+static void vmcall_kick(cpu_u32 apic_id) {
+    const cpu_u32 hypercall = KVM_HC_KICK_CPU;
+    _assemble(// clang-format off
+        _ins(_in(apic_id), _in(hypercall)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ebx), _clob(ecx), _clob(memory)),
+        _emitI(mov _var(apic_id), _reg(ecx))
+        _emitI(mov _var(hypercall), _reg(eax))
+        _emitI(xor _reg(ebx), _reg(ebx))
+        _emitI(vmcall)
+    );// clang-format on
+}
+
+static void vmmcall_kick(cpu_u32 apic_id) {
+    const cpu_u32 hypercall = KVM_HC_KICK_CPU;
+    _assemble(// clang-format off
+        _ins(_in(apic_id), _in(hypercall)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ebx), _clob(ecx), _clob(memory)),
+        _emitI(mov _var(apic_id), _reg(ecx))
+        _emitI(mov _var(hypercall), _reg(eax))
+        _emitI(xor _reg(ebx), _reg(ebx))
+        _emitI(vmmcall)
+    );// clang-format on
+}
+
+// The paravirtual MSRs take the guest physical address of the structure and an enable bit
+static cpu_bool register_structure(cpu_u32 msr, cpu_u64 physical_address) {
+    if(cpu_is_usermode()) {
+        return LCPU_FALSE;
+    }
+    cpu_wrmsr(msr, physical_address | KVM_MSR_ENABLED);
+    return LCPU_TRUE;
+}
+
+cpu_bool cpu_kvm_has_feature(CPUKVMFeature feature) {
+    if(cpu_get_hypervisor() != CPU_VENDOR_KVM) {
+        return LCPU_FALSE;
+    }
+    CPUID value;
+    lcpu_cpuid(0x40000001, 0, &value);
+    return (value.eax.value >> feature) & 1;
+}
+
+cpu_bool cpu_kvm_pvclock_init(cpu_u64 physical_address) {
+    if(cpu_kvm_has_feature(CPU_KVM_FEATURE_CLOCKSOURCE2)) {
+        return register_structure(KVM_MSR_SYSTEM_TIME_NEW, physical_address);
+    }
+    if(cpu_kvm_has_feature(CPU_KVM_FEATURE_CLOCKSOURCE)) {
+        return register_structure(KVM_MSR_SYSTEM_TIME, physical_address);
+    }
+    return LCPU_FALSE;
+}
+
+cpu_u64 cpu_kvm_pvclock_read(const CPUKVMPVClock* clock) {
+    cpu_u32 version;
+    cpu_u64 time;
+    do {
+        // The host updates the structure with an odd version and bumps it again once done
+        version = __atomic_load_n(&clock->version, __ATOMIC_ACQUIRE);
+        if((version & 1) != 0) {
+            continue;
+        }
+        cpu_u64 delta = cpu_rdtsc_lfence() - clock->tsc_timestamp;
+        const cpu_i8 shift = clock->tsc_shift;
+        delta = shift < 0 ? delta >> -shift : delta << shift;
+        // 64x32 bit multiplication with a 96 bit intermediate, split into two halves
+        const cpu_u64 mult = clock->tsc_to_system_mul;
+        time = clock->system_time + (((delta & 0xFFFFFFFF) * mult) >> 32) + (delta >> 32) * mult;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((version & 1) != 0 || version != clock->version);
+    return time;
+}
+
+cpu_bool cpu_kvm_steal_time_init(cpu_u64 physical_address) {
+    if(!cpu_kvm_has_feature(CPU_KVM_FEATURE_STEAL_TIME)) {
+        return LCPU_FALSE;
+    }
+    return register_structure(KVM_MSR_STEAL_TIME, physical_address);
+}
+
+cpu_u64 cpu_kvm_steal_time_read(const CPUKVMStealTime* steal_time) {
+    cpu_u32 version;
+    cpu_u64 steal;
+    do {
+        version = __atomic_load_n(&steal_time->version, __ATOMIC_ACQUIRE);
+        steal = steal_time->steal;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while((version & 1) != 0 || version != steal_time->version);
+    return steal;
+}
+
+cpu_bool cpu_kvm_is_preempted(const CPUKVMStealTime* steal_time) {
+    return (steal_time->preempted & KVM_STEAL_TIME_PREEMPTED) != 0;
+}
+
+void cpu_kvm_wait(const volatile cpu_u32* address, cpu_u32 expected) {
+    if(cpu_is_usermode() || !cpu_kvm_has_feature(CPU_KVM_FEATURE_PV_UNHALT)) {
+        cpu_hint_spin();
+        return;
+    }
+    // Check again with interrupts masked, so the kick can't arrive between the check and HLT
+    const cpu_bool were_enabled = (get_flags() & KVM_FLAGS_IF) != 0;
+    cli();
+    if(*address != expected) {
+        if(were_enabled) {
+            sti();
+        }
+        return;
+    }
+    if(were_enabled) {
+        sti_hlt();
+    }
+    else {
+        hlt();// Only a kick or NMI wakes the vCPU
+    }
+}
+
+void cpu_kvm_kick(cpu_u32 apic_id) {
+    if(cpu_is_usermode() || !cpu_kvm_has_feature(CPU_KVM_FEATURE_PV_UNHALT)) {
+        return;
+    }
+    // AMD processors only implement VMMCALL
+    if(cpu_get_vendor() == CPU_VENDOR_AMD) {
+        vmmcall_kick(apic_id);
+    }
+    else {
+        vmcall_kick(apic_id);
+    }
+}
+
+#endif// CPU_X86
@@ -18,27 +18,13 @@
 
 #pragma once
 
+#include "cpu/cpu.h"
 #include "cpu/cpu_types.h"
 
 // clang-format off
-#define LCPU_MEMSET(addr, value, size)                     \
-    do {                                                   \
-        cpu_u8* data = (cpu_u8*) addr;                     \
-        const cpu_u8 byte_value = (cpu_u8) (value & 0xFF); \
-        for(cpu_usize index = 0; index < size; ++index) {  \
-            data[index] = byte_value;                      \
-        }                                                  \
-    } while(0)
-
-#define LCPU_MEMCPY(dst, src, size)                       \
-    do {                                                  \
-        cpu_u8* dst_ptr = (cpu_u8*)dst;                   \
-        const cpu_u8* src_ptr = (const cpu_u8*)src;       \
-        for(cpu_usize index = 0; index < size; ++index) { \
-            dst_ptr[index] = src_ptr[index];              \
-        }                                                 \
-    } while(0)
-
+#define LCPU_MEMSET(addr, value, size) cpu_memset(addr, (cpu_u8) (value), size)
+#define LCPU_MEMCPY(dst, src, size) cpu_memcpy(dst, src, size)
+#define LCPU_MEMMOVE(dst, src, size) cpu_memmove(dst, src, size)
 #define LCPU_MEMCMP(addr1, addr2, size) memcmp_impl(addr1, addr2, size)
 #define LCPU_ARRAYLEN(array) (sizeof(array) / sizeof(*array))
 #define LCPU_STRLEN(address) strlen_impl(address)
@@ -0,0 +1,631 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu_x86.h"
+
+// Copies up to this size are done with overlapping scalar moves in every tier
+#define MEMORY_SMALL_SIZE 32
+// Minimum size from which rep movsb/stosb beats the vector loops with ERMS/FSRM
+#define MEMORY_REP_THRESHOLD 2048
+// Lower bound for the non-temporal threshold so small caches don't enable streaming too early
+#define MEMORY_MIN_NT_THRESHOLD (256 * 1024)
+#define MEMORY_THRESHOLD_NEVER ((cpu_usize) -1)
+// Destination alignment required by the streaming stores
+#define MEMORY_NT_ALIGNMENT 64
+
+#ifdef CPU_64_BIT
+#define MEMORY_WORD_SHIFT 3
+#define MEMORY_MOVS_WORD movsq
+#define MEMORY_STOS_WORD stosq
+#else
+#define MEMORY_WORD_SHIFT 2
+#define MEMORY_MOVS_WORD movsl
+#define MEMORY_STOS_WORD stosl
+#endif
+
+// clang-format off
+#define SSE2_LOAD(offset, reg) _emitI(movdqu _get(_var(src), offset), _reg(reg))
+#define SSE2_STORE(offset, reg) _emitI(movdqu _reg(reg), _get(_var(dst), offset))
+#define SSE2_STREAM(offset, reg) _emitI(movntdq _reg(reg), _get(_var(dst), offset))
+
+#define AVX2_LOAD(offset, reg) _emitI(vmovdqu _get(_var(src), offset), _reg(reg))
+#define AVX2_STORE(offset, reg) _emitI(vmovdqu _reg(reg), _get(_var(dst), offset))
+#define AVX2_STREAM(offset, reg) _emitI(vmovntdq _reg(reg), _get(_var(dst), offset))
+// clang-format on
+
+typedef cpu_u64 __attribute__((aligned(1), may_alias)) memory_unaligned_u64;
+typedef cpu_u32 __attribute__((aligned(1), may_alias)) memory_unaligned_u32;
+typedef cpu_u16 __attribute__((aligned(1), may_alias)) memory_unaligned_u16;
+
+/**
+ * A block kernel copying num_blocks blocks of the kernel's block size.
+ * Every block is loaded entirely before it is stored, so forward kernels
+ * are safe for overlapping buffers as long as dst is below src.
+ * Backward kernels receive pointers to the end of both buffers.
+ */
+typedef void (*MemoryCopyKernel)(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks);
+
+/**
+ * A block kernel filling num_blocks blocks of the kernel's block size with the given 8-byte pattern.
+ */
+typedef void (*MemorySetKernel)(cpu_u8* dst, const cpu_u64* pattern, cpu_usize num_blocks);
+
+/**
+ * A string instruction based routine handling an arbitrary number of bytes.
+ */
+typedef void (*MemoryCopyRoutine)(cpu_u8* dst, const cpu_u8* src, cpu_usize size);
+typedef void (*MemorySetRoutine)(cpu_u8* dst, cpu_u64 pattern, cpu_usize size);
+
+typedef struct _MemoryKernels {
+    MemoryCopyKernel copy;
+    MemoryCopyKernel copy_backward;
+    MemoryCopyKernel copy_nt;
+    MemorySetKernel set;
+    MemorySetKernel set_nt;
+    MemoryCopyRoutine copy_rep;
+    MemorySetRoutine set_rep;
+    cpu_usize block_shift;  // log2 of the number of bytes processed per block
+    cpu_usize rep_threshold;// Size from which the rep routines are used instead of the block kernels
+    cpu_usize nt_threshold; // Size from which streaming stores bypass the cache hierarchy
+} MemoryKernels;
+
+static void memory_copy_rep_words(cpu_u8* dst, const cpu_u8* src, cpu_usize size);
+static void memory_set_rep_words(cpu_u8* dst, cpu_u64 pattern, cpu_usize size);
+
+// clang-format off
+#define MEMORY_FALLBACK_KERNELS {                  \
+    nullptr, nullptr, nullptr, nullptr, nullptr,   \
+    memory_copy_rep_words, memory_set_rep_words,   \
+    0, 0, MEMORY_THRESHOLD_NEVER                   \
+}
+// clang-format on
+
+// NOLINTBEGIN
+// Used until cpu_init() is called, string instructions work without any enabled state
+static MemoryKernels g_kernels = MEMORY_FALLBACK_KERNELS;
+// NOLINTEND
+
+static void memory_copy_rep_words(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    const cpu_usize num_words = size >> MEMORY_WORD_SHIFT;
+    const cpu_usize num_bytes = size & ((1 << MEMORY_WORD_SHIFT) - 1);
+    _assemble(// clang-format off
+        _ins(_in(dst), _in(src), _in(num_words), _in(num_bytes)),
+        _outs(),
+        _clobs(_sclob(di), _sclob(si), _sclob(cx), _clob(memory)),
+        _emitI(mov _var(dst), _sreg(di))
+        _emitI(mov _var(src), _sreg(si))
+        _emitI(mov _var(num_words), _sreg(cx))
+        _emitI(rep MEMORY_MOVS_WORD)
+        _emitI(mov _var(num_bytes), _sreg(cx))
+        _emitI(rep movsb)
+    );// clang-format on
+}
+
+static void memory_copy_erms(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    _assemble(// clang-format off
+        _ins(_in(dst), _in(src), _in(size)),
+        _outs(),
+        _clobs(_sclob(di), _sclob(si), _sclob(cx), _clob(memory)),
+        _emitI(mov _var(dst), _sreg(di))
+        _emitI(mov _var(src), _sreg(si))
+        _emitI(mov _var(size), _sreg(cx))
+        _emitI(rep movsb)
+    );// clang-format on
+}
+
+// Copies from the last byte downwards, only used for the remainder of overlapping moves
+static void memory_copy_rep_backward(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    cpu_u8* dst_last = dst + size - 1;
+    const cpu_u8* src_last = src + size - 1;
+    _assemble(// clang-format off
+        _ins(_in(dst_last), _in(src_last), _in(size)),
+        _outs(),
+        _clobs(_sclob(di), _sclob(si), _sclob(cx), _clob(memory)),
+        _emitI(mov _var(dst_last), _sreg(di))
+        _emitI(mov _var(src_last), _sreg(si))
+        _emitI(mov _var(size), _sreg(cx))
+        _emitI(std)
+        _emitI(rep movsb)
+        _emitI(cld)
+    );// clang-format on
+}
+
+static void memory_set_rep_words(cpu_u8* dst, cpu_u64 pattern, cpu_usize size) {
+    const cpu_usize value = (cpu_usize) pattern;
+    const cpu_usize num_words = size >> MEMORY_WORD_SHIFT;
+    const cpu_usize num_bytes = size & ((1 << MEMORY_WORD_SHIFT) - 1);
+    _assemble(// clang-format off
+        _ins(_in(dst), _in(value), _in(num_words), _in(num_bytes)),
+        _outs(),
+        _clobs(_sclob(di), _sclob(ax), _sclob(cx), _clob(memory)),
+        _emitI(mov _var(dst), _sreg(di))
+        _emitI(mov _var(value), _sreg(ax))
+        _emitI(mov _var(num_words), _sreg(cx))
+        _emitI(rep MEMORY_STOS_WORD)
+        _emitI(mov _var(num_bytes), _sreg(cx))
+        _emitI(rep stosb)
+    );// clang-format on
+}
+
+static void memory_set_erms(cpu_u8* dst, cpu_u64 pattern, cpu_usize size) {
+    const cpu_usize value = (cpu_usize) pattern;
+    _assemble(// clang-format off
+        _ins(_in(dst), _in(value), _in(size)),
+        _outs(),
+        _clobs(_sclob(di), _sclob(ax), _sclob(cx), _clob(memory)),
+        _emitI(mov _var(dst), _sreg(di))
+        _emitI(mov _var(value), _sreg(ax))
+        _emitI(mov _var(size), _sreg(cx))
+        _emitI(rep stosb)
+    );// clang-format on
+}
+
+// 64 bytes per block
+static void memory_copy_sse2(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(dst), _inout(src), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(cc), _clob(memory)),
+        _emitL(1)
+        SSE2_LOAD(0, xmm0) SSE2_LOAD(16, xmm1) SSE2_LOAD(32, xmm2) SSE2_LOAD(48, xmm3)
+        SSE2_STORE(0, xmm0) SSE2_STORE(16, xmm1) SSE2_STORE(32, xmm2) SSE2_STORE(48, xmm3)
+        _emitI(add _imm(64), _var(src))
+        _emitI(add _imm(64), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+    );// clang-format on
+}
+
+// 64 bytes per block
+static void memory_copy_backward_sse2(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(dst), _inout(src), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(cc), _clob(memory)),
+        _emitL(1)
+        _emitI(sub _imm(64), _var(src))
+        _emitI(sub _imm(64), _var(dst))
+        SSE2_LOAD(0, xmm0) SSE2_LOAD(16, xmm1) SSE2_LOAD(32, xmm2) SSE2_LOAD(48, xmm3)
+        SSE2_STORE(0, xmm0) SSE2_STORE(16, xmm1) SSE2_STORE(32, xmm2) SSE2_STORE(48, xmm3)
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+    );// clang-format on
+}
+
+// 64 bytes per block, dst must be 16-byte aligned
+static void memory_copy_nt_sse2(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(dst), _inout(src), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(cc), _clob(memory)),
+        _emitL(1)
+        SSE2_LOAD(0, xmm0) SSE2_LOAD(16, xmm1) SSE2_LOAD(32, xmm2) SSE2_LOAD(48, xmm3)
+        SSE2_STREAM(0, xmm0) SSE2_STREAM(16, xmm1) SSE2_STREAM(32, xmm2) SSE2_STREAM(48, xmm3)
+        _emitI(add _imm(64), _var(src))
+        _emitI(add _imm(64), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(sfence)// Streaming stores are weakly ordered
+    );// clang-format on
+}
+
+// 64 bytes per block
+static void memory_set_sse2(cpu_u8* dst, const cpu_u64* pattern, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(_in(pattern)),
+        _outs(_inout(dst), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(cc), _clob(memory)),
+        _emitI(movq _get(_var(pattern)), _reg(xmm0))
+        _emitI(punpcklqdq _reg(xmm0), _reg(xmm0))
+        _emitL(1)
+        SSE2_STORE(0, xmm0) SSE2_STORE(16, xmm0) SSE2_STORE(32, xmm0) SSE2_STORE(48, xmm0)
+        _emitI(add _imm(64), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+    );// clang-format on
+}
+
+// 64 bytes per block, dst must be 16-byte aligned
+static void memory_set_nt_sse2(cpu_u8* dst, const cpu_u64* pattern, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(_in(pattern)),
+        _outs(_inout(dst), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(cc), _clob(memory)),
+        _emitI(movq _get(_var(pattern)), _reg(xmm0))
+        _emitI(punpcklqdq _reg(xmm0), _reg(xmm0))
+        _emitL(1)
+        SSE2_STREAM(0, xmm0) SSE2_STREAM(16, xmm0) SSE2_STREAM(32, xmm0) SSE2_STREAM(48, xmm0)
+        _emitI(add _imm(64), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(sfence)
+    );// clang-format on
+}
+
+// 128 bytes per block
+static void memory_copy_avx2(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(dst), _inout(src), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(cc), _clob(memory)),
+        _emitL(1)
+        AVX2_LOAD(0, ymm0) AVX2_LOAD(32, ymm1) AVX2_LOAD(64, ymm2) AVX2_LOAD(96, ymm3)
+        AVX2_STORE(0, ymm0) AVX2_STORE(32, ymm1) AVX2_STORE(64, ymm2) AVX2_STORE(96, ymm3)
+        _emitI(add _imm(128), _var(src))
+        _emitI(add _imm(128), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vzeroupper)
+    );// clang-format on
+}
+
+// 128 bytes per block
+static void memory_copy_backward_avx2(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(dst), _inout(src), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(cc), _clob(memory)),
+        _emitL(1)
+        _emitI(sub _imm(128), _var(src))
+        _emitI(sub _imm(128), _var(dst))
+        AVX2_LOAD(0, ymm0) AVX2_LOAD(32, ymm1) AVX2_LOAD(64, ymm2) AVX2_LOAD(96, ymm3)
+        AVX2_STORE(0, ymm0) AVX2_STORE(32, ymm1) AVX2_STORE(64, ymm2) AVX2_STORE(96, ymm3)
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vzeroupper)
+    );// clang-format on
+}
+
+// 128 bytes per block, dst must be 32-byte aligned
+static void memory_copy_nt_avx2(cpu_u8* dst, const cpu_u8* src, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(dst), _inout(src), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(cc), _clob(memory)),
+        _emitL(1)
+        AVX2_LOAD(0, ymm0) AVX2_LOAD(32, ymm1) AVX2_LOAD(64, ymm2) AVX2_LOAD(96, ymm3)
+        AVX2_STREAM(0, ymm0) AVX2_STREAM(32, ymm1) AVX2_STREAM(64, ymm2) AVX2_STREAM(96, ymm3)
+        _emitI(add _imm(128), _var(src))
+        _emitI(add _imm(128), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(sfence)
+        _emitI(vzeroupper)
+    );// clang-format on
+}
+
+// 128 bytes per block
+static void memory_set_avx2(cpu_u8* dst, const cpu_u64* pattern, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(_in(pattern)),
+        _outs(_inout(dst), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(cc), _clob(memory)),
+        _emitI(vpbroadcastq _get(_var(pattern)), _reg(ymm0))
+        _emitL(1)
+        AVX2_STORE(0, ymm0) AVX2_STORE(32, ymm0) AVX2_STORE(64, ymm0) AVX2_STORE(96, ymm0)
+        _emitI(add _imm(128), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vzeroupper)
+    );// clang-format on
+}
+
+// 128 bytes per block, dst must be 32-byte aligned
+static void memory_set_nt_avx2(cpu_u8* dst, const cpu_u64* pattern, cpu_usize num_blocks) {
+    _assemble(// clang-format off
+        _ins(_in(pattern)),
+        _outs(_inout(dst), _inout(num_blocks)),
+        _clobs(_clob(xmm0), _clob(cc), _clob(memory)),
+        _emitI(vpbroadcastq _get(_var(pattern)), _reg(ymm0))
+        _emitL(1)
+        AVX2_STREAM(0, ymm0) AVX2_STREAM(32, ymm0) AVX2_STREAM(64, ymm0) AVX2_STREAM(96, ymm0)
+        _emitI(add _imm(128), _var(dst))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(sfence)
+        _emitI(vzeroupper)
+    );// clang-format on
+}
+
+// Handles up to MEMORY_SMALL_SIZE bytes, all loads happen before the first store so buffers may overlap
+static inline void memory_copy_small(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    if(size >= 16) {
+        const cpu_u64 head0 = *(const memory_unaligned_u64*) src;
+        const cpu_u64 head1 = *(const memory_unaligned_u64*) (src + 8);
+        const cpu_u64 tail0 = *(const memory_unaligned_u64*) (src + size - 16);
+        const cpu_u64 tail1 = *(const memory_unaligned_u64*) (src + size - 8);
+        *(memory_unaligned_u64*) dst = head0;
+        *(memory_unaligned_u64*) (dst + 8) = head1;
+        *(memory_unaligned_u64*) (dst + size - 16) = tail0;
+        *(memory_unaligned_u64*) (dst + size - 8) = tail1;
+        return;
+    }
+    if(size >= 8) {
+        const cpu_u64 head = *(const memory_unaligned_u64*) src;
+        const cpu_u64 tail = *(const memory_unaligned_u64*) (src + size - 8);
+        *(memory_unaligned_u64*) dst = head;
+        *(memory_unaligned_u64*) (dst + size - 8) = tail;
+        return;
+    }
+    if(size >= 4) {
+        const cpu_u32 head = *(const memory_unaligned_u32*) src;
+        const cpu_u32 tail = *(const memory_unaligned_u32*) (src + size - 4);
+        *(memory_unaligned_u32*) dst = head;
+        *(memory_unaligned_u32*) (dst + size - 4) = tail;
+        return;
+    }
+    if(size >= 2) {
+        const cpu_u16 head = *(const memory_unaligned_u16*) src;
+        const cpu_u16 tail = *(const memory_unaligned_u16*) (src + size - 2);
+        *(memory_unaligned_u16*) dst = head;
+        *(memory_unaligned_u16*) (dst + size - 2) = tail;
+        return;
+    }
+    if(size == 1) {
+        *dst = *src;
+    }
+}
+
+static inline void memory_set_small(cpu_u8* dst, cpu_u64 pattern, cpu_usize size) {
+    if(size >= 16) {
+        *(memory_unaligned_u64*) dst = pattern;
+        *(memory_unaligned_u64*) (dst + 8) = pattern;
+        *(memory_unaligned_u64*) (dst + size - 16) = pattern;
+        *(memory_unaligned_u64*) (dst + size - 8) = pattern;
+        return;
+    }
+    if(size >= 8) {
+        *(memory_unaligned_u64*) dst = pattern;
+        *(memory_unaligned_u64*) (dst + size - 8) = pattern;
+        return;
+    }
+    if(size >= 4) {
+        *(memory_unaligned_u32*) dst = (cpu_u32) pattern;
+        *(memory_unaligned_u32*) (dst + size - 4) = (cpu_u32) pattern;
+        return;
+    }
+    if(size >= 2) {
+        *(memory_unaligned_u16*) dst = (cpu_u16) pattern;
+        *(memory_unaligned_u16*) (dst + size - 2) = (cpu_u16) pattern;
+        return;
+    }
+    if(size == 1) {
+        *dst = (cpu_u8) pattern;
+    }
+}
+
+// Copies non-overlapping buffers larger than MEMORY_SMALL_SIZE with the block kernels
+static void memory_copy_blocks(const MemoryKernels* kernels, cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    const cpu_usize block_size = (cpu_usize) 1 << kernels->block_shift;
+    if(size < block_size) {
+        // Chunks of MEMORY_SMALL_SIZE with a final chunk overlapping the previous one
+        cpu_usize offset = 0;
+        for(; offset + MEMORY_SMALL_SIZE < size; offset += MEMORY_SMALL_SIZE) {
+            memory_copy_small(dst + offset, src + offset, MEMORY_SMALL_SIZE);
+        }
+        memory_copy_small(dst + size - MEMORY_SMALL_SIZE, src + size - MEMORY_SMALL_SIZE, MEMORY_SMALL_SIZE);
+        return;
+    }
+    const cpu_usize num_blocks = size >> kernels->block_shift;
+    kernels->copy(dst, src, num_blocks);
+    if((num_blocks << kernels->block_shift) != size) {
+        // Remaining bytes are covered by one last block overlapping the previous one
+        kernels->copy(dst + size - block_size, src + size - block_size, 1);
+    }
+}
+
+static void memory_copy_streaming(const MemoryKernels* kernels, cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    // Align the destination with one regular block, the threshold guarantees there is enough left
+    const cpu_usize head = (MEMORY_NT_ALIGNMENT - ((cpu_usize) dst & (MEMORY_NT_ALIGNMENT - 1))) &
+                           (MEMORY_NT_ALIGNMENT - 1);
+    kernels->copy(dst, src, 1);
+    dst += head;
+    src += head;
+    size -= head;
+    const cpu_usize num_blocks = size >> kernels->block_shift;
+    kernels->copy_nt(dst, src, num_blocks);
+    if((num_blocks << kernels->block_shift) != size) {
+        const cpu_usize block_size = (cpu_usize) 1 << kernels->block_shift;
+        kernels->copy(dst + size - block_size, src + size - block_size, 1);
+    }
+}
+
+static void memory_copy(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    const MemoryKernels* kernels = &g_kernels;
+    if(size <= MEMORY_SMALL_SIZE) {
+        memory_copy_small(dst, src, size);
+        return;
+    }
+    if(size >= kernels->nt_threshold) {
+        memory_copy_streaming(kernels, dst, src, size);
+        return;
+    }
+    if(size >= kernels->rep_threshold) {
+        kernels->copy_rep(dst, src, size);
+        return;
+    }
+    memory_copy_blocks(kernels, dst, src, size);
+}
+
+static void memory_set(cpu_u8* dst, cpu_u64 pattern, cpu_usize size) {
+    const MemoryKernels* kernels = &g_kernels;
+    if(size <= MEMORY_SMALL_SIZE) {
+        memory_set_small(dst, pattern, size);
+        return;
+    }
+    const cpu_usize block_size = (cpu_usize) 1 << kernels->block_shift;
+    if(size >= kernels->nt_threshold) {
+        const cpu_usize head = (MEMORY_NT_ALIGNMENT - ((cpu_usize) dst & (MEMORY_NT_ALIGNMENT - 1))) &
+                               (MEMORY_NT_ALIGNMENT - 1);
+        kernels->set(dst, &pattern, 1);
+        dst += head;
+        size -= head;
+        const cpu_usize num_blocks = size >> kernels->block_shift;
+        kernels->set_nt(dst, &pattern, num_blocks);
+        if((num_blocks << kernels->block_shift) != size) {
+            kernels->set(dst + size - block_size, &pattern, 1);
+        }
+        return;
+    }
+    if(size >= kernels->rep_threshold) {
+        kernels->set_rep(dst, pattern, size);
+        return;
+    }
+    if(size < block_size) {
+        cpu_usize offset = 0;
+        for(; offset + MEMORY_SMALL_SIZE < size; offset += MEMORY_SMALL_SIZE) {
+            memory_set_small(dst + offset, pattern, MEMORY_SMALL_SIZE);
+        }
+        memory_set_small(dst + size - MEMORY_SMALL_SIZE, pattern, MEMORY_SMALL_SIZE);
+        return;
+    }
+    const cpu_usize num_blocks = size >> kernels->block_shift;
+    kernels->set(dst, &pattern, num_blocks);
+    if((num_blocks << kernels->block_shift) != size) {
+        kernels->set(dst + size - block_size, &pattern, 1);
+    }
+}
+
+// Moves overlapping buffers where dst lies below src by copying front to back
+static void memory_move_forward(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    const MemoryKernels* kernels = &g_kernels;
+    cpu_usize offset = 0;
+    if(kernels->copy != nullptr && size < kernels->rep_threshold) {
+        const cpu_usize num_blocks = size >> kernels->block_shift;
+        if(num_blocks != 0) {
+            kernels->copy(dst, src, num_blocks);
+            offset = num_blocks << kernels->block_shift;
+        }
+    }
+    // Forward string moves behave like a sequence of single moves, so they are overlap-safe here
+    if(size - offset <= MEMORY_SMALL_SIZE) {
+        memory_copy_small(dst + offset, src + offset, size - offset);
+        return;
+    }
+    kernels->copy_rep(dst + offset, src + offset, size - offset);
+}
+
+// Moves overlapping buffers where dst lies above src by copying back to front
+static void memory_move_backward(cpu_u8* dst, const cpu_u8* src, cpu_usize size) {
+    const MemoryKernels* kernels = &g_kernels;
+    cpu_usize remaining = size;
+    if(kernels->copy_backward != nullptr) {
+        const cpu_usize num_blocks = size >> kernels->block_shift;
+        if(num_blocks != 0) {
+            kernels->copy_backward(dst + size, src + size, num_blocks);
+            remaining -= num_blocks << kernels->block_shift;
+        }
+    }
+    if(remaining <= MEMORY_SMALL_SIZE) {
+        memory_copy_small(dst, src, remaining);
+        return;
+    }
+    memory_copy_rep_backward(dst, src, remaining);
+}
+
+// Streaming pays off once the buffer no longer fits into the shared cache alongside the working set
+static cpu_usize memory_get_nt_threshold() {
+    const cpu_usize cache_size = lcpu_get_shared_cache_size();
+    if(cache_size == 0) {
+        return MEMORY_THRESHOLD_NEVER;
+    }
+    const cpu_usize threshold = (cache_size >> 2) * 3;
+    return threshold < MEMORY_MIN_NT_THRESHOLD ? MEMORY_MIN_NT_THRESHOLD : threshold;
+}
+
+void lcpu_memory_init(const CPUFeatureSet* features) {
+    MemoryKernels kernels = MEMORY_FALLBACK_KERNELS;
+    if(cpu_feature_set_is_empty(features)) {
+        g_kernels = kernels;// Reset to the stateless fallback
+        return;
+    }
+    // String instructions need no state to be enabled, so use them whenever the processor has them
+    const CPUFeatureSet* available_features = &lcpu_get_info()->features;
+    const cpu_bool has_erms = cpu_feature_set_test(available_features, CPU_FEATURE_ERMS) ||
+                              cpu_feature_set_test(available_features, CPU_FEATURE_FSRM);
+    if(has_erms) {
+        kernels.copy_rep = memory_copy_erms;
+        kernels.set_rep = memory_set_erms;
+    }
+    CPU_XCR0 xcr0 = {0};
+    if(cpu_feature_set_test(features, CPU_FEATURE_XSAVE)) {
+        lcpu_get_xcr0(&xcr0);
+    }
+    if(cpu_feature_set_test(features, CPU_FEATURE_AVX2) && xcr0.sse && xcr0.avx) {
+        kernels.copy = memory_copy_avx2;
+        kernels.copy_backward = memory_copy_backward_avx2;
+        kernels.copy_nt = memory_copy_nt_avx2;
+        kernels.set = memory_set_avx2;
+        kernels.set_nt = memory_set_nt_avx2;
+        kernels.block_shift = 7;
+    }
+    else if(cpu_feature_set_test(features, CPU_FEATURE_SSE2)) {
+        kernels.copy = memory_copy_sse2;
+        kernels.copy_backward = memory_copy_backward_sse2;
+        kernels.copy_nt = memory_copy_nt_sse2;
+        kernels.set = memory_set_sse2;
+        kernels.set_nt = memory_set_nt_sse2;
+        kernels.block_shift = 6;
+    }
+    if(kernels.copy != nullptr) {
+        // Even with FSRM the unrolled loops win on short copies, so rep movsb only takes over for long ones
+        kernels.rep_threshold = has_erms ? MEMORY_REP_THRESHOLD : MEMORY_THRESHOLD_NEVER;
+        kernels.nt_threshold = memory_get_nt_threshold();
+    }
+    g_kernels = kernels;
+}
+
+void* cpu_memcpy(void* dst, const void* src, cpu_usize size) {
+    memory_copy((cpu_u8*) dst, (const cpu_u8*) src, size);
+    return dst;
+}
+
+void* cpu_memmove(void* dst, const void* src, cpu_usize size) {
+    cpu_u8* dst_ptr = (cpu_u8*) dst;
+    const cpu_u8* src_ptr = (const cpu_u8*) src;
+    if(size <= MEMORY_SMALL_SIZE) {
+        memory_copy_small(dst_ptr, src_ptr, size);
+        return dst;
+    }
+    const cpu_usize dst_address = (cpu_usize) dst_ptr;
+    const cpu_usize src_address = (cpu_usize) src_ptr;
+    if(dst_address == src_address) {
+        return dst;
+    }
+    if(dst_address + size <= src_address || src_address + size <= dst_address) {
+        memory_copy(dst_ptr, src_ptr, size);
+        return dst;
+    }
+    if(dst_address < src_address) {
+        memory_move_forward(dst_ptr, src_ptr, size);
+        return dst;
+    }
+    memory_move_backward(dst_ptr, src_ptr, size);
+    return dst;
+}
+
+void* cpu_memset(void* dst, cpu_u8 value, cpu_usize size) {
+    memory_set((cpu_u8*) dst, value * 0x0101010101010101ULL, size);
+    return dst;
+}
+
+#endif// CPU_X86
@@ -0,0 +1,197 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define MEMTYPE_MSR_MTRRCAP 0xFE
+#define MEMTYPE_MSR_MTRR_PHYSBASE0 0x200// Interleaved with the masks
+#define MEMTYPE_MSR_MTRR_PHYSMASK0 0x201
+#define MEMTYPE_MSR_PAT 0x277
+#define MEMTYPE_MSR_MTRR_DEF_TYPE 0x2FF
+
+#define MEMTYPE_MTRRCAP_FIX (1ULL << 8)
+#define MEMTYPE_MTRRCAP_WC (1ULL << 10)
+#define MEMTYPE_DEF_TYPE_FE (1ULL << 10)
+#define MEMTYPE_DEF_TYPE_E (1ULL << 11)
+#define MEMTYPE_PHYSMASK_VALID (1ULL << 11)
+
+#define MEMTYPE_PTE_PWT (1ULL << 3)
+#define MEMTYPE_PTE_PCD (1ULL << 4)
+#define MEMTYPE_PTE_PAT (1ULL << 7)
+#define MEMTYPE_PTE_PAT_LARGE (1ULL << 12)
+
+#define MEMTYPE_PAT_ENTRIES 8
+#define MEMTYPE_PAGE_MASK 0xFFFULL
+#define MEMTYPE_DEFAULT_PHYSICAL_ADDRESS_SIZE 36
+
+// NOLINTBEGIN
+static const CPUMemoryType g_default_pat[MEMTYPE_PAT_ENTRIES] = {
+    CPU_MEMORY_TYPE_WB, CPU_MEMORY_TYPE_WT, CPU_MEMORY_TYPE_UC_MINUS, CPU_MEMORY_TYPE_UC,
+    CPU_MEMORY_TYPE_WB, CPU_MEMORY_TYPE_WT, CPU_MEMORY_TYPE_UC_MINUS, CPU_MEMORY_TYPE_UC,
+};
+
+static const CPUMemoryType g_libcpu_pat[MEMTYPE_PAT_ENTRIES] = {
+    CPU_MEMORY_TYPE_WB, CPU_MEMORY_TYPE_WC, CPU_MEMORY_TYPE_UC_MINUS, CPU_MEMORY_TYPE_UC,
+    CPU_MEMORY_TYPE_WB, CPU_MEMORY_TYPE_WP, CPU_MEMORY_TYPE_UC_MINUS, CPU_MEMORY_TYPE_WT,
+};
+
+static const CPUMemoryType* g_pat = g_default_pat;
+// NOLINTEND
+
+static void wbinvd() {
+    _assemble(_ins(), _outs(), _clobs(_clob(memory)), _emitI(wbinvd));
+}
+
+static cpu_u64 get_physical_address_mask() {
+    CPUID value;
+    lcpu_cpuid(0x80000008, 0, &value);
+    cpu_u32 size = value.eax.leaf80000008.physical_address_size;
+    if(size == 0) {
+        size = MEMTYPE_DEFAULT_PHYSICAL_ADDRESS_SIZE;
+    }
+    return (1ULL << size) - 1;
+}
+
+static cpu_bool read_range(cpu_u32 index, cpu_u64 address_mask, CPUMTRRRange* range) {
+    cpu_u64 base = 0;
+    cpu_u64 mask = 0;
+    if(!cpu_msr_probe(MEMTYPE_MSR_MTRR_PHYSMASK0 + (index << 1), &mask) || (mask & MEMTYPE_PHYSMASK_VALID) == 0) {
+        return LCPU_FALSE;
+    }
+    if(!cpu_msr_probe(MEMTYPE_MSR_MTRR_PHYSBASE0 + (index << 1), &base)) {
+        return LCPU_FALSE;
+    }
+    range->base = base & address_mask;
+    range->mask = mask & address_mask;
+    range->size = (~range->mask & address_mask) + MEMTYPE_PAGE_MASK + 1;// The lowest set bit of a contiguous mask
+    range->type = (CPUMemoryType) (base & 0xFF);
+    return LCPU_TRUE;
+}
+
+cpu_bool cpu_pat_init() {
+    if(cpu_is_usermode() || !cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_PAT)) {
+        return LCPU_FALSE;
+    }
+    cpu_u64 pat = 0;
+    for(cpu_u32 index = 0; index < MEMTYPE_PAT_ENTRIES; ++index) {
+        pat |= (cpu_u64) g_libcpu_pat[index] << (index << 3);
+    }
+    // Follows the SDM: no line may be cached under its old type while the PAT changes
+    CPU_CR0 cr0;
+    lcpu_get_cr0(&cr0);
+    const CPU_CR0 old_cr0 = cr0;
+    cr0.cd = LCPU_TRUE;
+    cr0.nw = LCPU_FALSE;
+    lcpu_set_cr0(&cr0);
+    wbinvd();
+    cpu_tlb_flush_all();
+    const cpu_bool is_written = cpu_msr_write_safe(MEMTYPE_MSR_PAT, pat);
+    wbinvd();
+    cpu_tlb_flush_all();
+    lcpu_set_cr0(&old_cr0);
+    if(!is_written) {
+        return LCPU_FALSE;
+    }
+    g_pat = g_libcpu_pat;
+    return LCPU_TRUE;
+}
+
+cpu_bool cpu_pat_get_pte_bits(CPUMemoryType type, cpu_bool is_large_page, cpu_u64* bits) {
+    for(cpu_u32 index = 0; index < MEMTYPE_PAT_ENTRIES; ++index) {
+        if(g_pat[index] != type) {
+            continue;
+        }
+        cpu_u64 value = 0;
+        value |= (index & 1) != 0 ? MEMTYPE_PTE_PWT : 0;
+        value |= (index & 2) != 0 ? MEMTYPE_PTE_PCD : 0;
+        if((index & 4) != 0) {
+            value |= is_large_page ? MEMTYPE_PTE_PAT_LARGE : MEMTYPE_PTE_PAT;
+        }
+        *bits = value;
+        return LCPU_TRUE;
+    }
+    return LCPU_FALSE;
+}
+
+cpu_bool cpu_mtrr_get_info(CPUMTRRInfo* info) {
+    if(!cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_MTRR)) {
+        return LCPU_FALSE;
+    }
+    cpu_u64 capabilities = 0;
+    cpu_u64 default_type = 0;
+    if(!cpu_msr_probe(MEMTYPE_MSR_MTRRCAP, &capabilities) ||
+       !cpu_msr_probe(MEMTYPE_MSR_MTRR_DEF_TYPE, &default_type)) {
+        return LCPU_FALSE;
+    }
+    info->is_enabled = (default_type & MEMTYPE_DEF_TYPE_E) != 0;
+    info->has_fixed = (capabilities & MEMTYPE_MTRRCAP_FIX) != 0;
+    info->is_fixed_enabled = info->is_enabled && (default_type & MEMTYPE_DEF_TYPE_FE) != 0;
+    info->has_wc = (capabilities & MEMTYPE_MTRRCAP_WC) != 0;
+    info->default_type = (CPUMemoryType) (default_type & 0xFF);
+    info->num_variable = (cpu_u8) capabilities;
+    return LCPU_TRUE;
+}
+
+cpu_usize cpu_mtrr_get_ranges(CPUMTRRRange* ranges, cpu_usize max_ranges) {
+    CPUMTRRInfo info;
+    if(!cpu_mtrr_get_info(&info) || !info.is_enabled) {
+        return 0;
+    }
+    const cpu_u64 address_mask = get_physical_address_mask() & ~MEMTYPE_PAGE_MASK;
+    cpu_usize count = 0;
+    for(cpu_u32 index = 0; index < info.num_variable; ++index) {
+        CPUMTRRRange range;
+        if(!read_range(index, address_mask, &range)) {
+            continue;
+        }
+        if(ranges != nullptr && count < max_ranges) {
+            ranges[count] = range;
+        }
+        ++count;
+    }
+    return count;
+}
+
+cpu_bool cpu_mtrr_find_conflict(cpu_u64 base, cpu_u64 size, CPUMemoryType type, CPUMTRRRange* conflict) {
+    CPUMTRRInfo info;
+    if(size == 0 || !cpu_mtrr_get_info(&info) || !info.is_enabled) {
+        return LCPU_FALSE;
+    }
+    const cpu_u64 address_mask = get_physical_address_mask() & ~MEMTYPE_PAGE_MASK;
+    for(cpu_u32 index = 0; index < info.num_variable; ++index) {
+        CPUMTRRRange range;
+        if(!read_range(index, address_mask, &range) || range.type == type) {
+            continue;
+        }
+        if(base >= range.base + range.size || range.base >= base + size) {
+            continue;
+        }
+        if(conflict != nullptr) {
+            *conflict = range;
+        }
+        return LCPU_TRUE;
+    }
+    return LCPU_FALSE;
+}
+
+#endif// CPU_X86
@@ -0,0 +1,180 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+#include "memory.h"
+
+// The probes reference global labels, so they must never be inlined or duplicated
+#if defined(COMPILER_GCC)
+#define MSR_PROBE __attribute__((noinline, noclone))
+#else
+#define MSR_PROBE __attribute__((noinline))
+#endif
+
+typedef struct _MSRFixup {
+    const void* fault_address;
+    const void* fixup_address;
+} MSRFixup;
+
+extern const cpu_u8 lcpu_msr_probe_rdmsr[];
+extern const cpu_u8 lcpu_msr_fixup_rdmsr[];
+extern const cpu_u8 lcpu_msr_probe_wrmsr[];
+extern const cpu_u8 lcpu_msr_fixup_wrmsr[];
+
+// NOLINTBEGIN
+static const MSRFixup g_msr_fixups[] = {
+    {lcpu_msr_probe_rdmsr, lcpu_msr_fixup_rdmsr},
+    {lcpu_msr_probe_wrmsr, lcpu_msr_fixup_wrmsr},
+};
+// NOLINTEND
+
+// The error flag is only cleared if the instruction retires, a #GP resumes at the fixup label with it still set
+static MSR_PROBE cpu_bool rdmsr_safe(cpu_u32 msr, cpu_u64* value) {
+    cpu_u32 low = 0;
+    cpu_u32 high = 0;
+    cpu_u32 error = 0;
+    _assemble(// clang-format off
+        _ins(_in(msr)),
+        _outs(_out(low), _out(high), _out(error)),
+        _clobs(_clob(eax), _clob(ecx), _clob(edx)),
+        _emitI(mov _var(msr), _reg(ecx))
+        _emitI(mov _imm(1), _var(error))
+        _emitI(.globl lcpu_msr_probe_rdmsr)
+        _emitL(lcpu_msr_probe_rdmsr)
+        _emitI(rdmsr)
+        _emitI(xor _var(error), _var(error))
+        _emitI(.globl lcpu_msr_fixup_rdmsr)
+        _emitL(lcpu_msr_fixup_rdmsr)
+        _emitI(mov _reg(eax), _var(low))
+        _emitI(mov _reg(edx), _var(high))
+    );// clang-format on
+    if(error != 0) {
+        return LCPU_FALSE;
+    }
+    *value = ((cpu_u64) high << 32) | low;
+    return LCPU_TRUE;
+}
+
+static MSR_PROBE cpu_bool wrmsr_safe(cpu_u32 msr, cpu_u64 value) {
+    const cpu_u32 low = (cpu_u32) value;
+    const cpu_u32 high = (cpu_u32) (value >> 32);
+    cpu_u32 error = 0;
+    _assemble(// clang-format off
+        _ins(_in(msr), _in(low), _in(high)),
+        _outs(_out(error)),
+        _clobs(_clob(eax), _clob(ecx), _clob(edx), _clob(memory)),
+        _emitI(mov _var(msr), _reg(ecx))
+        _emitI(mov _var(low), _reg(eax))
+        _emitI(mov _var(high), _reg(edx))
+        _emitI(mov _imm(1), _var(error))
+        _emitI(.globl lcpu_msr_probe_wrmsr)
+        _emitL(lcpu_msr_probe_wrmsr)
+        _emitI(wrmsr)
+        _emitI(xor _var(error), _var(error))
+        _emitI(.globl lcpu_msr_fixup_wrmsr)
+        _emitL(lcpu_msr_fixup_wrmsr)
+    );// clang-format on
+    return error == 0;
+}
+
+cpu_u64 cpu_rdmsr(cpu_u32 msr) {
+    cpu_u32 low = 0;
+    cpu_u32 high = 0;
+    _assemble(// clang-format off
+        _ins(_in(msr)),
+        _outs(_out(low), _out(high)),
+        _clobs(_clob(eax), _clob(ecx), _clob(edx)),
+        _emitI(mov _var(msr), _reg(ecx))
+        _emitI(rdmsr)
+        _emitI(mov _reg(eax), _var(low))
+        _emitI(mov _reg(edx), _var(high))
+    );// clang-format on
+    return ((cpu_u64) high << 32) | low;
+}
+
+void cpu_wrmsr(cpu_u32 msr, cpu_u64 value) {
+    const cpu_u32 low = (cpu_u32) value;
+    const cpu_u32 high = (cpu_u32) (value >> 32);
+    _assemble(// clang-format off
+        _ins(_in(msr), _in(low), _in(high)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ecx), _clob(edx), _clob(memory)),
+        _emitI(mov _var(msr), _reg(ecx))
+        _emitI(mov _var(low), _reg(eax))
+        _emitI(mov _var(high), _reg(edx))
+        _emitI(wrmsr)
+    );// clang-format on
+}
+
+cpu_bool cpu_msr_probe(cpu_u32 msr, cpu_u64* value) {
+    if(cpu_is_usermode()) {
+        return LCPU_FALSE;
+    }
+    cpu_u64 dummy = 0;
+    return rdmsr_safe(msr, value != nullptr ? value : &dummy);
+}
+
+cpu_bool cpu_msr_write_safe(cpu_u32 msr, cpu_u64 value) {
+    if(cpu_is_usermode()) {
+        return LCPU_FALSE;
+    }
+    return wrmsr_safe(msr, value);
+}
+
+cpu_usize cpu_msr_apply(const CPUMSRWrite* writes, cpu_usize count) {
+    if(cpu_is_usermode()) {
+        return 0;
+    }
+    for(cpu_usize index = 0; index < count; ++index) {
+        const CPUMSRWrite* write = &writes[index];
+        cpu_u64 value = write->value;
+        if(write->mask != ~0ULL) {
+            cpu_u64 current = 0;
+            if(!rdmsr_safe(write->msr, &current)) {
+                return index;
+            }
+            value = (current & ~write->mask) | (value & write->mask);
+            // WRMSR is serializing, so don't pay for it if nothing changes
+            if(value == current) {
+                continue;
+            }
+        }
+        if(!wrmsr_safe(write->msr, value)) {
+            return index;
+        }
+    }
+    return count;
+}
+
+cpu_bool cpu_msr_fixup(cpu_usize* instruction_pointer) {
+    for(cpu_usize index = 0; index < LCPU_ARRAYLEN(g_msr_fixups); ++index) {
+        const MSRFixup* fixup = &g_msr_fixups[index];
+        if(*instruction_pointer == (cpu_usize) fixup->fault_address) {
+            *instruction_pointer = (cpu_usize) fixup->fixup_address;
+            return LCPU_TRUE;
+        }
+    }
+    return LCPU_FALSE;
+}
+
+#endif// CPU_X86
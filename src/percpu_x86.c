@@ -0,0 +1,116 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define PERCPU_MSR_GS_BASE 0xC0000101
+#define PERCPU_MSR_TSC_AUX 0xC0000103
+
+// TSC_AUX is only trusted if it carries this tag, since processors which didn't run cpu_percpu_init()
+// hold whatever the firmware or OS stored there, usually 0
+#define PERCPU_TSC_AUX_TAG 0xC5000000
+#define PERCPU_TSC_AUX_ID_MASK 0x00FFFFFF
+
+// NOLINTBEGIN
+static cpu_bool g_is_tsc_aux_used = LCPU_FALSE;// Some processor stored its tagged APIC ID in TSC_AUX
+// NOLINTEND
+
+static cpu_u32 rdpid() {
+    cpu_usize value = 0;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_out(value)),
+        _clobs(),
+        _emitI(rdpid _var(value))
+    );// clang-format on
+    return (cpu_u32) value;
+}
+
+static cpu_bool read_tsc_aux(cpu_u32* value) {
+    const CPUFeatureSet* features = &lcpu_get_info()->features;
+    if(cpu_feature_set_test(features, CPU_FEATURE_RDPID)) {
+        *value = rdpid();
+        return LCPU_TRUE;
+    }
+    if(cpu_feature_set_test(features, CPU_FEATURE_RDTSCP)) {
+        cpu_rdtscp(value);
+        return LCPU_TRUE;
+    }
+    return LCPU_FALSE;
+}
+
+cpu_u32 cpu_current_id() {
+    cpu_u32 value = 0;
+    if(cpu_atomic_load8(&g_is_tsc_aux_used, CPU_MEMORY_ORDER_RELAXED) && read_tsc_aux(&value) &&
+       (value & ~PERCPU_TSC_AUX_ID_MASK) == PERCPU_TSC_AUX_TAG) {
+        return value & PERCPU_TSC_AUX_ID_MASK;
+    }
+    return cpu_get_apic_id();
+}
+
+#ifdef CPU_64_BIT
+
+LCPU_STATIC_ASSERT(__builtin_offsetof(CPUPerCPUHeader, self) == 0, "Self pointer must be at the start of the block");
+
+static void wrgsbase(void* base) {
+    _assemble(// clang-format off
+        _ins(_in(base)),
+        _outs(),
+        _clobs(_clob(memory)),
+        _emitI(wrgsbase _var(base))
+    );// clang-format on
+}
+
+cpu_bool cpu_percpu_init(void* base, cpu_usize size) {
+    if(cpu_is_usermode() || size < sizeof(CPUPerCPUHeader)) {
+        return LCPU_FALSE;
+    }
+    const cpu_u32 id = cpu_get_apic_id();
+    CPUPerCPUHeader* header = (CPUPerCPUHeader*) base;
+    header->self = base;
+    header->size = size;
+    header->id = id;
+
+    CPU_CR4 cr4;
+    lcpu_get_cr4(&cr4);
+    if(cr4.fsgsbase) {
+        wrgsbase(base);// Not serializing, unlike WRMSR
+    }
+    else {
+        cpu_wrmsr(PERCPU_MSR_GS_BASE, (cpu_u64) base);
+    }
+
+    const CPUFeatureSet* features = &lcpu_get_info()->features;
+    const cpu_bool has_tsc_aux =
+            cpu_feature_set_test(features, CPU_FEATURE_RDPID) || cpu_feature_set_test(features, CPU_FEATURE_RDTSCP);
+    if(has_tsc_aux && (id & ~PERCPU_TSC_AUX_ID_MASK) == 0) {
+        cpu_wrmsr(PERCPU_MSR_TSC_AUX, PERCPU_TSC_AUX_TAG | id);
+        cpu_atomic_store8(&g_is_tsc_aux_used, LCPU_TRUE, CPU_MEMORY_ORDER_RELAXED);
+    }
+    return LCPU_TRUE;
+}
+
+#endif// CPU_64_BIT
+
+#endif// CPU_X86
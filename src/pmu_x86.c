@@ -0,0 +1,209 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+#include "memory.h"
+
+#define PMU_MSR_PMC0 0xC1
+#define PMU_MSR_PERFEVTSEL0 0x186
+#define PMU_MSR_FIXED_CTR0 0x309
+#define PMU_MSR_FIXED_CTR_CTRL 0x38D
+#define PMU_MSR_PERF_GLOBAL_CTRL 0x38F
+#define PMU_MSR_AMD_PERF_LEGACY_CTL0 0xC0010000
+#define PMU_MSR_AMD_PERF_LEGACY_CTR0 0xC0010004
+#define PMU_MSR_AMD_PERF_CTL0 0xC0010200// Interleaved with the counters
+#define PMU_MSR_AMD_PERF_CTR0 0xC0010201
+#define PMU_MSR_AMD_PERF_GLOBAL_CTL 0xC0000301
+
+#define PMU_EVTSEL_USR (1ULL << 16)
+#define PMU_EVTSEL_OS (1ULL << 17)
+#define PMU_EVTSEL_EN (1ULL << 22)
+
+#define PMU_FIXED_CTRL_OS 0x1
+#define PMU_FIXED_CTRL_USR 0x2
+#define PMU_FIXED_CTRL_BITS 4// Control bits per fixed counter
+
+#define PMU_AMD_LEGACY_COUNTERS 4
+#define PMU_AMD_CORE_COUNTERS 6
+#define PMU_AMD_COUNTER_WIDTH 48
+
+#define PMU_EVENT_NONE 0xFFFF
+
+// Event select in the low byte, unit mask in the high byte
+// NOLINTBEGIN
+static const cpu_u16 g_intel_events[CPU_PMU_EVENT_COUNT] = {
+    0x003C,// UnHalted Core Cycles
+    0x00C0,// Instructions Retired
+    0x013C,// UnHalted Reference Cycles
+    0x4F2E,// LLC Reference
+    0x412E,// LLC Misses
+    0x00C4,// Branch Instructions Retired
+    0x00C5,// Branch Misses Retired
+};
+
+// The core PMU doesn't see the L3, which has its own counters on AMD
+static const cpu_u16 g_amd_events[CPU_PMU_EVENT_COUNT] = {
+    0x0076,// Cycles not in Halt
+    0x00C0,// Retired Instructions
+    PMU_EVENT_NONE,
+    PMU_EVENT_NONE,
+    PMU_EVENT_NONE,
+    0x00C2,// Retired Branch Instructions
+    0x00C3,// Retired Branch Instructions Mispredicted
+};
+// NOLINTEND
+
+static CPUPMUInfo get_intel_info() {
+    CPUPMUInfo info = {0};
+    CPUID value;
+    lcpu_cpuid(0xA, 0, &value);
+    info.version = value.eax.leafA.version;
+    if(info.version == 0) {
+        return info;
+    }
+    info.num_counters = value.eax.leafA.num_counters;
+    info.counter_width = value.eax.leafA.counter_width;
+    if(info.version > 1) {
+        info.num_fixed_counters = value.edx.leafA.num_fixed_counters;
+        info.fixed_counter_width = value.edx.leafA.fixed_counter_width;
+        info.has_global_ctrl = LCPU_TRUE;
+    }
+    for(cpu_u32 index = 0; index < CPU_PMU_EVENT_COUNT && index < value.eax.leafA.num_events; ++index) {
+        if(((value.ebx.value >> index) & 1) == 0) {
+            info.events |= 1U << index;
+        }
+    }
+    return info;
+}
+
+static CPUPMUInfo get_amd_info() {
+    CPUPMUInfo info = {0};
+    info.counter_width = PMU_AMD_COUNTER_WIDTH;
+    for(cpu_u32 index = 0; index < CPU_PMU_EVENT_COUNT; ++index) {
+        if(g_amd_events[index] != PMU_EVENT_NONE) {
+            info.events |= 1U << index;
+        }
+    }
+    CPUID value;
+    lcpu_cpuid(0x80000022, 0, &value);
+    if(value.eax.leaf80000022.perfmon_v2) {
+        info.num_counters = value.ebx.leaf80000022.num_core_counters;
+        info.has_global_ctrl = LCPU_TRUE;
+        return info;
+    }
+    info.num_counters = cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_PERFCTR_CORE)
+                                ? PMU_AMD_CORE_COUNTERS
+                                : PMU_AMD_LEGACY_COUNTERS;
+    return info;
+}
+
+static cpu_bool is_amd() {
+    return cpu_get_vendor() == CPU_VENDOR_AMD;
+}
+
+// RDPMC faults in usermode unless CR4.PCE is set
+static void enable_pce() {
+    CPU_CR4 cr4;
+    lcpu_get_cr4(&cr4);
+    if(cr4.pce) {
+        return;
+    }
+    cr4.pce = LCPU_TRUE;
+    lcpu_set_cr4(&cr4);
+}
+
+CPUPMUInfo cpu_pmu_get_info() {
+    return is_amd() ? get_amd_info() : get_intel_info();
+}
+
+cpu_bool cpu_pmu_configure(cpu_u32 counter, CPUPMUEvent event, CPUPMUCount count) {
+    if(event >= CPU_PMU_EVENT_COUNT || (cpu_pmu_get_info().events & (1U << event)) == 0) {
+        return LCPU_FALSE;
+    }
+    const cpu_u16 code = is_amd() ? g_amd_events[event] : g_intel_events[event];
+    return cpu_pmu_configure_raw(counter, code & 0xFF, (cpu_u8) (code >> 8), count);
+}
+
+cpu_bool cpu_pmu_configure_raw(cpu_u32 counter, cpu_u16 event, cpu_u8 unit_mask, CPUPMUCount count) {
+    const CPUPMUInfo info = cpu_pmu_get_info();
+    if(cpu_is_usermode() || counter >= info.num_counters) {
+        return LCPU_FALSE;
+    }
+    cpu_u64 select = (event & 0xFF) | ((cpu_u64) unit_mask << 8);
+    select |= (cpu_u64) (event & 0xF00) << 24;// AMD extended event select in bits 35:32
+    select |= (count & CPU_PMU_COUNT_USER) != 0 ? PMU_EVTSEL_USR : 0;
+    select |= (count & CPU_PMU_COUNT_KERNEL) != 0 ? PMU_EVTSEL_OS : 0;
+    select |= count != CPU_PMU_COUNT_NONE ? PMU_EVTSEL_EN : 0;
+    cpu_u32 control_msr = PMU_MSR_PERFEVTSEL0 + counter;
+    cpu_u32 counter_msr = PMU_MSR_PMC0 + counter;
+    cpu_u32 global_msr = PMU_MSR_PERF_GLOBAL_CTRL;
+    if(is_amd()) {
+        global_msr = PMU_MSR_AMD_PERF_GLOBAL_CTL;
+        if(info.num_counters > PMU_AMD_LEGACY_COUNTERS || info.has_global_ctrl) {
+            control_msr = PMU_MSR_AMD_PERF_CTL0 + (counter << 1);
+            counter_msr = PMU_MSR_AMD_PERF_CTR0 + (counter << 1);
+        }
+        else {
+            control_msr = PMU_MSR_AMD_PERF_LEGACY_CTL0 + counter;
+            counter_msr = PMU_MSR_AMD_PERF_LEGACY_CTR0 + counter;
+        }
+    }
+    const cpu_u64 global_bit = 1ULL << counter;
+    // Stop the counter before clearing it, so it starts from 0 once enabled again
+    const CPUMSRWrite writes[] = {
+        {control_msr, 0, ~0ULL},
+        {counter_msr, 0, ~0ULL},
+        {control_msr, select, ~0ULL},
+        {global_msr, count != CPU_PMU_COUNT_NONE ? global_bit : 0, global_bit},
+    };
+    const cpu_usize num_writes = LCPU_ARRAYLEN(writes) - (info.has_global_ctrl ? 0 : 1);
+    if(cpu_msr_apply(writes, num_writes) != num_writes) {
+        return LCPU_FALSE;
+    }
+    enable_pce();
+    return LCPU_TRUE;
+}
+
+cpu_bool cpu_pmu_configure_fixed(cpu_u32 counter, CPUPMUCount count) {
+    const CPUPMUInfo info = cpu_pmu_get_info();
+    if(cpu_is_usermode() || counter >= info.num_fixed_counters) {
+        return LCPU_FALSE;
+    }
+    const cpu_u32 shift = counter * PMU_FIXED_CTRL_BITS;
+    cpu_u64 control = 0;
+    control |= (count & CPU_PMU_COUNT_USER) != 0 ? PMU_FIXED_CTRL_USR : 0;
+    control |= (count & CPU_PMU_COUNT_KERNEL) != 0 ? PMU_FIXED_CTRL_OS : 0;
+    const cpu_u64 global_bit = 1ULL << (32 + counter);// Fixed counters start at bit 32
+    const CPUMSRWrite writes[] = {
+        {PMU_MSR_FIXED_CTR_CTRL, 0, 0xFULL << shift},
+        {PMU_MSR_FIXED_CTR0 + counter, 0, ~0ULL},
+        {PMU_MSR_FIXED_CTR_CTRL, control << shift, 0xFULL << shift},
+        {PMU_MSR_PERF_GLOBAL_CTRL, count != CPU_PMU_COUNT_NONE ? global_bit : 0, global_bit},
+    };
+    if(cpu_msr_apply(writes, LCPU_ARRAYLEN(writes)) != LCPU_ARRAYLEN(writes)) {
+        return LCPU_FALSE;
+    }
+    enable_pce();
+    return LCPU_TRUE;
+}
+
+#endif// CPU_X86
@@ -0,0 +1,69 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Portable constant-time (SWAR) population count helpers which are
+ * used as a fallback when no hardware support is available.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#pragma once
+
+#include "cpu/cpu_types.h"
+
+typedef cpu_u64 __attribute__((aligned(1), may_alias)) popcnt_unaligned_u64;
+
+static inline cpu_usize popcnt32_impl(cpu_u32 value) {
+    value = value - ((value >> 1) & 0x55555555U);
+    value = (value & 0x33333333U) + ((value >> 2) & 0x33333333U);
+    value = (value + (value >> 4)) & 0x0F0F0F0FU;
+    return (cpu_usize) ((value * 0x01010101U) >> 24);
+}
+
+static inline cpu_usize popcnt64_impl(cpu_u64 value) {
+    value = value - ((value >> 1) & 0x5555555555555555ULL);
+    value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+    value = (value + (value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (cpu_usize) ((value * 0x0101010101010101ULL) >> 56);
+}
+
+/**
+ * Count the 1-bits in the given buffer, optionally AND-ed with a second buffer.
+ * @param data The buffer to count 1-bits in.
+ * @param mask A buffer of the same size which is AND-ed with data, or nullptr.
+ * @param size The size of both buffers in bytes.
+ * @return The number of 1-bits in the given buffer.
+ */
+static inline cpu_u64 popcnt_buffer_impl(const cpu_u8* data, const cpu_u8* mask, cpu_usize size) {
+    cpu_u64 count = 0;
+    cpu_usize index = 0;
+    if(mask == nullptr) {
+        for(; index + sizeof(cpu_u64) <= size; index += sizeof(cpu_u64)) {
+            count += popcnt64_impl(*(const popcnt_unaligned_u64*) (data + index));
+        }
+        for(; index < size; ++index) {
+            count += popcnt32_impl(data[index]);
+        }
+        return count;
+    }
+    for(; index + sizeof(cpu_u64) <= size; index += sizeof(cpu_u64)) {
+        const cpu_u64 value = *(const popcnt_unaligned_u64*) (data + index);
+        count += popcnt64_impl(value & *(const popcnt_unaligned_u64*) (mask + index));
+    }
+    for(; index < size; ++index) {
+        count += popcnt32_impl(data[index] & mask[index]);
+    }
+    return count;
+}
@@ -0,0 +1,426 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu_x86.h"
+#include "popcnt.h"
+#include "stats.h"
+
+// clang-format off
+// Counts the 1-bits of XMM0 into the byte-wise accumulator XMM3 using the nibble LUT in XMM7
+#define SSSE3_COUNT                        \
+    _emitI(movdqa _reg(xmm0), _reg(xmm1)) \
+    _emitI(psrlw _imm(4), _reg(xmm1))     \
+    _emitI(pand _reg(xmm6), _reg(xmm0))   \
+    _emitI(pand _reg(xmm6), _reg(xmm1))   \
+    _emitI(movdqa _reg(xmm7), _reg(xmm2)) \
+    _emitI(pshufb _reg(xmm0), _reg(xmm2)) \
+    _emitI(paddb _reg(xmm2), _reg(xmm3))  \
+    _emitI(movdqa _reg(xmm7), _reg(xmm2)) \
+    _emitI(pshufb _reg(xmm1), _reg(xmm2)) \
+    _emitI(paddb _reg(xmm2), _reg(xmm3))
+
+#define SSSE3_LOAD(offset) \
+    _emitI(movdqu _get(_var(data), offset), _reg(xmm0))
+
+#define SSSE3_LOAD_AND(offset)                          \
+    SSSE3_LOAD(offset)                                  \
+    _emitI(movdqu _get(_var(mask), offset), _reg(xmm1)) \
+    _emitI(pand _reg(xmm1), _reg(xmm0))
+
+// Counts the 1-bits of YMM0 into the byte-wise accumulator YMM3 using the nibble LUT in YMM7
+#define AVX2_COUNT                                     \
+    _emitI(vpsrlw _imm(4), _reg(ymm0), _reg(ymm1))     \
+    _emitI(vpand _reg(ymm6), _reg(ymm0), _reg(ymm0))   \
+    _emitI(vpand _reg(ymm6), _reg(ymm1), _reg(ymm1))   \
+    _emitI(vpshufb _reg(ymm0), _reg(ymm7), _reg(ymm0)) \
+    _emitI(vpshufb _reg(ymm1), _reg(ymm7), _reg(ymm1)) \
+    _emitI(vpaddb _reg(ymm0), _reg(ymm3), _reg(ymm3))  \
+    _emitI(vpaddb _reg(ymm1), _reg(ymm3), _reg(ymm3))
+
+#define AVX2_LOAD(offset) \
+    _emitI(vmovdqu _get(_var(data), offset), _reg(ymm0))
+
+#define AVX2_LOAD_AND(offset) \
+    AVX2_LOAD(offset)         \
+    _emitI(vpand _get(_var(mask), offset), _reg(ymm0), _reg(ymm0))
+
+// Counts the 1-bits of ZMM0 into one of the qword-wise accumulators ZMM4/ZMM5
+#define AVX512_COUNT(acc)                      \
+    _emitI(vpopcntq _reg(zmm0), _reg(zmm0))    \
+    _emitI(vpaddq _reg(zmm0), _reg(acc), _reg(acc))
+
+#define AVX512_LOAD(offset) \
+    _emitI(vmovdqu64 _get(_var(data), offset), _reg(zmm0))
+
+#define AVX512_LOAD_AND(offset) \
+    AVX512_LOAD(offset)         \
+    _emitI(vpandq _get(_var(mask), offset), _reg(zmm0), _reg(zmm0))
+// clang-format on
+
+/**
+ * A bulk popcount kernel processing num_blocks blocks of the kernel's block size.
+ * The mask pointer is only accessed by the AND variants.
+ */
+typedef cpu_u64 (*PopcntKernel)(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks);
+
+typedef struct _PopcntKernels {
+    PopcntKernel count;
+    PopcntKernel count_and;
+    cpu_usize block_shift;// log2 of the number of bytes processed per block
+} PopcntKernels;
+
+// NOLINTBEGIN
+// clang-format off
+alignas(16) static const cpu_u8 g_popcnt_lut[16] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4
+};
+alignas(16) static const cpu_u8 g_popcnt_nibble_mask[16] = {
+    0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F,
+    0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F, 0x0F
+};
+// clang-format on
+static PopcntKernels g_kernels = {nullptr, nullptr, 0};
+// NOLINTEND
+
+#ifdef CPU_64_BIT
+// 32 bytes per block
+static cpu_u64 popcnt_popcnt(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    (void) mask;
+    cpu_u64 count = 0;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(data), _inout(num_blocks), _inout(count)),
+        _clobs(_clob(rax), _clob(rdx), _clob(cc), _clob(memory)),
+        _emitL(1)
+        _emitI(popcnt _get(_var(data), 0), _reg(rax))
+        _emitI(popcnt _get(_var(data), 8), _reg(rdx))
+        _emitI(add _reg(rax), _var(count))
+        _emitI(add _reg(rdx), _var(count))
+        _emitI(popcnt _get(_var(data), 16), _reg(rax))
+        _emitI(popcnt _get(_var(data), 24), _reg(rdx))
+        _emitI(add _reg(rax), _var(count))
+        _emitI(add _reg(rdx), _var(count))
+        _emitI(add _imm(32), _var(data))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+    );// clang-format on
+    return count;
+}
+
+// 32 bytes per block
+static cpu_u64 popcnt_popcnt_and(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    cpu_u64 count = 0;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(data), _inout(mask), _inout(num_blocks), _inout(count)),
+        _clobs(_clob(rax), _clob(rdx), _clob(cc), _clob(memory)),
+        _emitL(1)
+        _emitI(mov _get(_var(data), 0), _reg(rax))
+        _emitI(mov _get(_var(data), 8), _reg(rdx))
+        _emitI(and _get(_var(mask), 0), _reg(rax))
+        _emitI(and _get(_var(mask), 8), _reg(rdx))
+        _emitI(popcnt _reg(rax), _reg(rax))
+        _emitI(popcnt _reg(rdx), _reg(rdx))
+        _emitI(add _reg(rax), _var(count))
+        _emitI(add _reg(rdx), _var(count))
+        _emitI(mov _get(_var(data), 16), _reg(rax))
+        _emitI(mov _get(_var(data), 24), _reg(rdx))
+        _emitI(and _get(_var(mask), 16), _reg(rax))
+        _emitI(and _get(_var(mask), 24), _reg(rdx))
+        _emitI(popcnt _reg(rax), _reg(rax))
+        _emitI(popcnt _reg(rdx), _reg(rdx))
+        _emitI(add _reg(rax), _var(count))
+        _emitI(add _reg(rdx), _var(count))
+        _emitI(add _imm(32), _var(data))
+        _emitI(add _imm(32), _var(mask))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+    );// clang-format on
+    return count;
+}
+#endif// CPU_64_BIT
+
+// 64 bytes per block
+static cpu_u64 popcnt_ssse3(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    (void) mask;
+    cpu_u64 count = 0;
+    cpu_u64* result = &count;
+    const cpu_u8* lut = g_popcnt_lut;
+    const cpu_u8* nibble_mask = g_popcnt_nibble_mask;
+    _assemble(// clang-format off
+        _ins(_in(lut), _in(nibble_mask)),
+        _outs(_inout(data), _inout(num_blocks), _inout(result)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(xmm4), _clob(xmm5), _clob(xmm6),
+               _clob(xmm7), _clob(cc), _clob(memory)),
+        _emitI(movdqa _get(_var(lut)), _reg(xmm7))
+        _emitI(movdqa _get(_var(nibble_mask)), _reg(xmm6))
+        _emitI(pxor _reg(xmm5), _reg(xmm5))
+        _emitI(pxor _reg(xmm4), _reg(xmm4))
+        _emitL(1)
+        _emitI(pxor _reg(xmm3), _reg(xmm3))
+        SSSE3_LOAD(0) SSSE3_COUNT
+        SSSE3_LOAD(16) SSSE3_COUNT
+        SSSE3_LOAD(32) SSSE3_COUNT
+        SSSE3_LOAD(48) SSSE3_COUNT
+        _emitI(psadbw _reg(xmm4), _reg(xmm3))
+        _emitI(paddq _reg(xmm3), _reg(xmm5))
+        _emitI(add _imm(64), _var(data))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(pshufd _imm(0x4E), _reg(xmm5), _reg(xmm0))
+        _emitI(paddq _reg(xmm0), _reg(xmm5))
+        _emitI(movq _reg(xmm5), _get(_var(result)))
+    );// clang-format on
+    return count;
+}
+
+// 64 bytes per block
+static cpu_u64 popcnt_ssse3_and(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    cpu_u64 count = 0;
+    cpu_u64* result = &count;
+    const cpu_u8* lut = g_popcnt_lut;
+    const cpu_u8* nibble_mask = g_popcnt_nibble_mask;
+    _assemble(// clang-format off
+        _ins(_in(lut), _in(nibble_mask)),
+        _outs(_inout(data), _inout(mask), _inout(num_blocks), _inout(result)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm2), _clob(xmm3), _clob(xmm4), _clob(xmm5), _clob(xmm6),
+               _clob(xmm7), _clob(cc), _clob(memory)),
+        _emitI(movdqa _get(_var(lut)), _reg(xmm7))
+        _emitI(movdqa _get(_var(nibble_mask)), _reg(xmm6))
+        _emitI(pxor _reg(xmm5), _reg(xmm5))
+        _emitI(pxor _reg(xmm4), _reg(xmm4))
+        _emitL(1)
+        _emitI(pxor _reg(xmm3), _reg(xmm3))
+        SSSE3_LOAD_AND(0) SSSE3_COUNT
+        SSSE3_LOAD_AND(16) SSSE3_COUNT
+        SSSE3_LOAD_AND(32) SSSE3_COUNT
+        SSSE3_LOAD_AND(48) SSSE3_COUNT
+        _emitI(psadbw _reg(xmm4), _reg(xmm3))
+        _emitI(paddq _reg(xmm3), _reg(xmm5))
+        _emitI(add _imm(64), _var(data))
+        _emitI(add _imm(64), _var(mask))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(pshufd _imm(0x4E), _reg(xmm5), _reg(xmm0))
+        _emitI(paddq _reg(xmm0), _reg(xmm5))
+        _emitI(movq _reg(xmm5), _get(_var(result)))
+    );// clang-format on
+    return count;
+}
+
+// 128 bytes per block
+static cpu_u64 popcnt_avx2(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    (void) mask;
+    cpu_u64 count = 0;
+    cpu_u64* result = &count;
+    const cpu_u8* lut = g_popcnt_lut;
+    const cpu_u8* nibble_mask = g_popcnt_nibble_mask;
+    _assemble(// clang-format off
+        _ins(_in(lut), _in(nibble_mask)),
+        _outs(_inout(data), _inout(num_blocks), _inout(result)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm3), _clob(xmm4), _clob(xmm5), _clob(xmm6), _clob(xmm7),
+               _clob(cc), _clob(memory)),
+        _emitI(vbroadcasti128 _get(_var(lut)), _reg(ymm7))
+        _emitI(vbroadcasti128 _get(_var(nibble_mask)), _reg(ymm6))
+        _emitI(vpxor _reg(ymm5), _reg(ymm5), _reg(ymm5))
+        _emitI(vpxor _reg(ymm4), _reg(ymm4), _reg(ymm4))
+        _emitL(1)
+        _emitI(vpxor _reg(ymm3), _reg(ymm3), _reg(ymm3))
+        AVX2_LOAD(0) AVX2_COUNT
+        AVX2_LOAD(32) AVX2_COUNT
+        AVX2_LOAD(64) AVX2_COUNT
+        AVX2_LOAD(96) AVX2_COUNT
+        _emitI(vpsadbw _reg(ymm4), _reg(ymm3), _reg(ymm3))
+        _emitI(vpaddq _reg(ymm3), _reg(ymm5), _reg(ymm5))
+        _emitI(add _imm(128), _var(data))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vextracti128 _imm(1), _reg(ymm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vpunpckhqdq _reg(xmm5), _reg(xmm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vmovq _reg(xmm5), _get(_var(result)))
+        _emitI(vzeroupper)
+    );// clang-format on
+    return count;
+}
+
+// 128 bytes per block
+static cpu_u64 popcnt_avx2_and(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    cpu_u64 count = 0;
+    cpu_u64* result = &count;
+    const cpu_u8* lut = g_popcnt_lut;
+    const cpu_u8* nibble_mask = g_popcnt_nibble_mask;
+    _assemble(// clang-format off
+        _ins(_in(lut), _in(nibble_mask)),
+        _outs(_inout(data), _inout(mask), _inout(num_blocks), _inout(result)),
+        _clobs(_clob(xmm0), _clob(xmm1), _clob(xmm3), _clob(xmm4), _clob(xmm5), _clob(xmm6), _clob(xmm7),
+               _clob(cc), _clob(memory)),
+        _emitI(vbroadcasti128 _get(_var(lut)), _reg(ymm7))
+        _emitI(vbroadcasti128 _get(_var(nibble_mask)), _reg(ymm6))
+        _emitI(vpxor _reg(ymm5), _reg(ymm5), _reg(ymm5))
+        _emitI(vpxor _reg(ymm4), _reg(ymm4), _reg(ymm4))
+        _emitL(1)
+        _emitI(vpxor _reg(ymm3), _reg(ymm3), _reg(ymm3))
+        AVX2_LOAD_AND(0) AVX2_COUNT
+        AVX2_LOAD_AND(32) AVX2_COUNT
+        AVX2_LOAD_AND(64) AVX2_COUNT
+        AVX2_LOAD_AND(96) AVX2_COUNT
+        _emitI(vpsadbw _reg(ymm4), _reg(ymm3), _reg(ymm3))
+        _emitI(vpaddq _reg(ymm3), _reg(ymm5), _reg(ymm5))
+        _emitI(add _imm(128), _var(data))
+        _emitI(add _imm(128), _var(mask))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vextracti128 _imm(1), _reg(ymm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vpunpckhqdq _reg(xmm5), _reg(xmm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vmovq _reg(xmm5), _get(_var(result)))
+        _emitI(vzeroupper)
+    );// clang-format on
+    return count;
+}
+
+// 256 bytes per block
+static cpu_u64 popcnt_avx512(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    (void) mask;
+    cpu_u64 count = 0;
+    cpu_u64* result = &count;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(data), _inout(num_blocks), _inout(result)),
+        _clobs(_clob(xmm0), _clob(xmm4), _clob(xmm5), _clob(cc), _clob(memory)),
+        _emitI(vpxorq _reg(zmm5), _reg(zmm5), _reg(zmm5))
+        _emitI(vpxorq _reg(zmm4), _reg(zmm4), _reg(zmm4))
+        _emitL(1)
+        AVX512_LOAD(0) AVX512_COUNT(zmm4)
+        AVX512_LOAD(64) AVX512_COUNT(zmm5)
+        AVX512_LOAD(128) AVX512_COUNT(zmm4)
+        AVX512_LOAD(192) AVX512_COUNT(zmm5)
+        _emitI(add _imm(256), _var(data))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vpaddq _reg(zmm4), _reg(zmm5), _reg(zmm5))
+        _emitI(vextracti64x4 _imm(1), _reg(zmm5), _reg(ymm0))
+        _emitI(vpaddq _reg(ymm0), _reg(ymm5), _reg(ymm5))
+        _emitI(vextracti128 _imm(1), _reg(ymm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vpunpckhqdq _reg(xmm5), _reg(xmm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vmovq _reg(xmm5), _get(_var(result)))
+        _emitI(vzeroupper)
+    );// clang-format on
+    return count;
+}
+
+// 256 bytes per block
+static cpu_u64 popcnt_avx512_and(const cpu_u8* data, const cpu_u8* mask, cpu_usize num_blocks) {
+    cpu_u64 count = 0;
+    cpu_u64* result = &count;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_inout(data), _inout(mask), _inout(num_blocks), _inout(result)),
+        _clobs(_clob(xmm0), _clob(xmm4), _clob(xmm5), _clob(cc), _clob(memory)),
+        _emitI(vpxorq _reg(zmm5), _reg(zmm5), _reg(zmm5))
+        _emitI(vpxorq _reg(zmm4), _reg(zmm4), _reg(zmm4))
+        _emitL(1)
+        AVX512_LOAD_AND(0) AVX512_COUNT(zmm4)
+        AVX512_LOAD_AND(64) AVX512_COUNT(zmm5)
+        AVX512_LOAD_AND(128) AVX512_COUNT(zmm4)
+        AVX512_LOAD_AND(192) AVX512_COUNT(zmm5)
+        _emitI(add _imm(256), _var(data))
+        _emitI(add _imm(256), _var(mask))
+        _emitI(dec _var(num_blocks))
+        _emitI(jnz 1b)
+        _emitI(vpaddq _reg(zmm4), _reg(zmm5), _reg(zmm5))
+        _emitI(vextracti64x4 _imm(1), _reg(zmm5), _reg(ymm0))
+        _emitI(vpaddq _reg(ymm0), _reg(ymm5), _reg(ymm5))
+        _emitI(vextracti128 _imm(1), _reg(ymm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vpunpckhqdq _reg(xmm5), _reg(xmm5), _reg(xmm0))
+        _emitI(vpaddq _reg(xmm0), _reg(xmm5), _reg(xmm5))
+        _emitI(vmovq _reg(xmm5), _get(_var(result)))
+        _emitI(vzeroupper)
+    );// clang-format on
+    return count;
+}
+
+static cpu_u64 popcnt_buffer(const cpu_u8* data, const cpu_u8* mask, cpu_usize size) {
+    const PopcntKernels* kernels = &g_kernels;
+    cpu_u64 count = 0;
+    cpu_usize offset = 0;
+    if(kernels->count != nullptr) {
+        const cpu_usize num_blocks = size >> kernels->block_shift;
+        if(num_blocks != 0) {
+            if(mask == nullptr) {
+                count = kernels->count(data, nullptr, num_blocks);
+            }
+            else {
+                count = kernels->count_and(data, mask, num_blocks);
+            }
+            offset = num_blocks << kernels->block_shift;
+        }
+    }
+    // Remaining bytes which don't fill an entire block
+    return count + popcnt_buffer_impl(data + offset, mask == nullptr ? nullptr : mask + offset, size - offset);
+}
+
+void lcpu_popcnt_init(const CPUFeatureSet* features) {
+    CPU_XCR0 xcr0 = {0};
+    if(cpu_feature_set_test(features, CPU_FEATURE_XSAVE)) {
+        lcpu_get_xcr0(&xcr0);
+    }
+    if(cpu_feature_set_test(features, CPU_FEATURE_AVX512VPOPCNTDQ) && xcr0.opmask && xcr0.zmm_hi256 &&
+       xcr0.hi16_zmm) {
+        g_kernels = (PopcntKernels){popcnt_avx512, popcnt_avx512_and, 8};
+        return;
+    }
+    if(cpu_feature_set_test(features, CPU_FEATURE_AVX2) && xcr0.sse && xcr0.avx) {
+        g_kernels = (PopcntKernels){popcnt_avx2, popcnt_avx2_and, 7};
+        return;
+    }
+    if(cpu_feature_set_test(features, CPU_FEATURE_SSSE3)) {
+        g_kernels = (PopcntKernels){popcnt_ssse3, popcnt_ssse3_and, 6};
+        return;
+    }
+#ifdef CPU_64_BIT
+    // POPCNT needs no state to be enabled, so it's usable whenever the processor has it
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_POPCNT)) {
+        g_kernels = (PopcntKernels){popcnt_popcnt, popcnt_popcnt_and, 5};
+        return;
+    }
+#endif
+    g_kernels = (PopcntKernels){nullptr, nullptr, 0};
+}
+
+cpu_u64 cpu_popcnt_buffer(const void* data, cpu_usize size) {
+    LCPU_INSTRUMENT(CPU_STATS_API_POPCNT_BUFFER);
+    return popcnt_buffer((const cpu_u8*) data, nullptr, size);
+}
+
+cpu_u64 cpu_popcnt_buffer_and(const void* data, const void* mask, cpu_usize size) {
+    LCPU_INSTRUMENT(CPU_STATS_API_POPCNT_BUFFER_AND);
+    return popcnt_buffer((const cpu_u8*) data, (const cpu_u8*) mask, size);
+}
+
+#endif// CPU_X86
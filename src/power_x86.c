@@ -0,0 +1,123 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define POWER_MSR_PERF_STATUS 0x198
+#define POWER_MSR_MISC_ENABLE 0x1A0
+#define POWER_MSR_ENERGY_PERF_BIAS 0x1B0
+#define POWER_MSR_PM_ENABLE 0x770
+#define POWER_MSR_HWP_CAPABILITIES 0x771
+#define POWER_MSR_HWP_REQUEST 0x774
+#define POWER_MSR_AMD_HWCR 0xC0010015
+
+#define POWER_MISC_ENABLE_TURBO_DISABLE (1ULL << 38)
+#define POWER_AMD_HWCR_CPB_DISABLE (1ULL << 25)
+
+// CPUID.6:EAX.ITB reads 0 while turbo is disabled through IA32_MISC_ENABLE, so check both
+static cpu_bool has_intel_turbo(const CPUID* leaf6) {
+    if(leaf6->eax.leaf6.itb) {
+        return LCPU_TRUE;
+    }
+    cpu_u64 misc_enable = 0;
+    return cpu_get_vendor() == CPU_VENDOR_INTEL && cpu_msr_probe(POWER_MSR_MISC_ENABLE, &misc_enable) &&
+           (misc_enable & POWER_MISC_ENABLE_TURBO_DISABLE) != 0;
+}
+
+CPUPowerCaps cpu_get_power_caps() {
+    const CPUFeatureSet* features = &lcpu_get_info()->features;
+    CPUID value;
+    lcpu_cpuid(6, 0, &value);
+    CPUPowerCaps caps = {0};
+    caps.has_turbo = has_intel_turbo(&value) || cpu_feature_set_test(features, CPU_FEATURE_CPB);
+    caps.has_arat = value.eax.leaf6.arat;
+    caps.has_hwp = value.eax.leaf6.hwp;
+    caps.has_hwp_epp = value.eax.leaf6.hwp_energy_perf_pref;
+    caps.has_hwp_package_request = value.eax.leaf6.hwp_package_level_req;
+    caps.has_aperf_mperf = value.ecx.leaf6.aperf_mperf;
+    caps.has_energy_perf_bias = value.ecx.leaf6.energy_perf_bias;
+    // The capabilities MSR is only readable once HWP is reported, and changes at runtime
+    if(caps.has_hwp && !cpu_is_usermode()) {
+        const cpu_u64 hwp_caps = cpu_rdmsr(POWER_MSR_HWP_CAPABILITIES);
+        caps.highest_perf = (cpu_u8) hwp_caps;
+        caps.guaranteed_perf = (cpu_u8) (hwp_caps >> 8);
+        caps.efficient_perf = (cpu_u8) (hwp_caps >> 16);
+        caps.lowest_perf = (cpu_u8) (hwp_caps >> 24);
+    }
+    return caps;
+}
+
+cpu_bool cpu_set_perf_preference(cpu_u8 min_perf, cpu_u8 max_perf, cpu_u8 epp) {
+    const CPUPowerCaps caps = cpu_get_power_caps();
+    if(!caps.has_hwp || cpu_is_usermode() || min_perf > max_perf) {
+        return LCPU_FALSE;
+    }
+    // Once enabled, HWP can only be disabled by a reset
+    if((cpu_rdmsr(POWER_MSR_PM_ENABLE) & 1) == 0) {
+        cpu_wrmsr(POWER_MSR_PM_ENABLE, 1);
+    }
+    // Leave the desired performance at 0, so the hardware selects it autonomously within the bounds
+    cpu_u64 request = cpu_rdmsr(POWER_MSR_HWP_REQUEST);
+    request &= ~0xFFFFFFULL;
+    request |= (cpu_u64) min_perf | ((cpu_u64) max_perf << 8);
+    if(caps.has_hwp_epp) {// Bits 31:24 are reserved without EPP
+        request &= ~0xFF000000ULL;
+        request |= (cpu_u64) epp << 24;
+    }
+    cpu_wrmsr(POWER_MSR_HWP_REQUEST, request);
+    // Processors without EPP fall back to the 4-bit energy/performance bias
+    if(!caps.has_hwp_epp && caps.has_energy_perf_bias) {
+        cpu_wrmsr(POWER_MSR_ENERGY_PERF_BIAS, epp >> 4);
+    }
+    return LCPU_TRUE;
+}
+
+cpu_bool cpu_set_turbo(cpu_bool is_enabled) {
+    if(cpu_is_usermode()) {
+        return LCPU_FALSE;
+    }
+    CPUID value;
+    lcpu_cpuid(6, 0, &value);
+    if(has_intel_turbo(&value)) {// Intel Turbo Boost
+        cpu_u64 misc_enable = cpu_rdmsr(POWER_MSR_MISC_ENABLE);
+        misc_enable = is_enabled ? misc_enable & ~POWER_MISC_ENABLE_TURBO_DISABLE
+                                 : misc_enable | POWER_MISC_ENABLE_TURBO_DISABLE;
+        cpu_wrmsr(POWER_MSR_MISC_ENABLE, misc_enable);
+        return LCPU_TRUE;
+    }
+    if(cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_CPB)) {// AMD Core Performance Boost
+        cpu_u64 hwcr = cpu_rdmsr(POWER_MSR_AMD_HWCR);
+        hwcr = is_enabled ? hwcr & ~POWER_AMD_HWCR_CPB_DISABLE : hwcr | POWER_AMD_HWCR_CPB_DISABLE;
+        cpu_wrmsr(POWER_MSR_AMD_HWCR, hwcr);
+        return LCPU_TRUE;
+    }
+    return LCPU_FALSE;
+}
+
+cpu_u8 cpu_get_current_perf() {
+    if(cpu_get_vendor() != CPU_VENDOR_INTEL || cpu_is_usermode()) {
+        return 0;
+    }
+    return (cpu_u8) (cpu_rdmsr(POWER_MSR_PERF_STATUS) >> 8);// Current ratio in bits 15:8
+}
+
+#endif// CPU_X86
@@ -0,0 +1,177 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define SPIN_CALIBRATION_PAUSES 64
+#define SPIN_MAX_BACKOFF_CYCLES 4096// Upper bound of a single backoff step
+#define SPIN_CONTROL_C02 0
+#define SPIN_CONTROL_C01 1
+
+typedef struct _SpinInfo {
+    cpu_u32 max_pauses;// Number of PAUSE instructions in a fully backed off step
+    cpu_bool has_waitpkg;
+} SpinInfo;
+
+// NOLINTBEGIN
+static SpinInfo g_spin = {0, LCPU_FALSE};
+static cpu_bool g_is_spin_valid = LCPU_FALSE;
+// NOLINTEND
+
+static void tpause(cpu_u32 control, cpu_u64 deadline) {
+    const cpu_u32 low = (cpu_u32) deadline;
+    const cpu_u32 high = (cpu_u32) (deadline >> 32);
+    _assemble(// clang-format off
+        _ins(_in(control), _in(low), _in(high)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ecx), _clob(edx), _clob(cc)),
+        _emitI(mov _var(low), _reg(eax))
+        _emitI(mov _var(high), _reg(edx))
+        _emitI(mov _var(control), _reg(ecx))
+        _emitI(tpause _reg(ecx))
+    );// clang-format on
+}
+
+static void umonitor(const volatile void* address) {
+    _assemble(// clang-format off
+        _ins(_in(address)),
+        _outs(),
+        _clobs(_sclob(ax), _clob(memory)),
+        _emitI(mov _var(address), _sreg(ax))
+        _emitI(umonitor _sreg(ax))
+    );// clang-format on
+}
+
+static void umwait(cpu_u32 control, cpu_u64 deadline) {
+    const cpu_u32 low = (cpu_u32) deadline;
+    const cpu_u32 high = (cpu_u32) (deadline >> 32);
+    _assemble(// clang-format off
+        _ins(_in(control), _in(low), _in(high)),
+        _outs(),
+        _clobs(_clob(eax), _clob(ecx), _clob(edx), _clob(cc), _clob(memory)),
+        _emitI(mov _var(low), _reg(eax))
+        _emitI(mov _var(high), _reg(edx))
+        _emitI(mov _var(control), _reg(ecx))
+        _emitI(umwait _reg(ecx))
+    );// clang-format on
+}
+
+// PAUSE takes anywhere from ~10 to ~140 cycles depending on the microarchitecture
+static const SpinInfo* get_spin() {
+    if(cpu_atomic_load8(&g_is_spin_valid, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return &g_spin;
+    }
+    // Calibrate into a local copy, so concurrent callers never observe a partially written result
+    SpinInfo spin = {0, LCPU_FALSE};
+    const cpu_u64 start = cpu_rdtsc_lfence();
+    for(cpu_u32 index = 0; index < SPIN_CALIBRATION_PAUSES; ++index) {
+        cpu_hint_spin();
+    }
+    const cpu_u64 cycles_per_pause = (cpu_rdtsc_lfence() - start) / SPIN_CALIBRATION_PAUSES;
+    spin.max_pauses = cycles_per_pause == 0 ? SPIN_MAX_BACKOFF_CYCLES
+                                            : (cpu_u32) (SPIN_MAX_BACKOFF_CYCLES / cycles_per_pause);
+    if(spin.max_pauses == 0) {
+        spin.max_pauses = 1;
+    }
+    spin.has_waitpkg = cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_WAITPKG);
+    lcpu_decode_lock();
+    if(!g_is_spin_valid) {
+        g_spin = spin;
+        cpu_atomic_store8(&g_is_spin_valid, LCPU_TRUE, CPU_MEMORY_ORDER_RELEASE);
+    }
+    lcpu_decode_unlock();
+    return &g_spin;
+}
+
+static cpu_u64 get_deadline(cpu_u64 timeout_cycles) {
+    const cpu_u64 now = cpu_rdtsc();
+    return timeout_cycles > CPU_SPIN_FOREVER - now ? CPU_SPIN_FOREVER : now + timeout_cycles;
+}
+
+static cpu_u32 get_control(CPUSpinLatency latency) {
+    return latency == CPU_SPIN_LATENCY_LOW ? SPIN_CONTROL_C01 : SPIN_CONTROL_C02;
+}
+
+static void backoff(cpu_u32 num_pauses) {
+    for(cpu_u32 index = 0; index < num_pauses; ++index) {
+        cpu_hint_spin();
+    }
+}
+
+cpu_bool cpu_spin_until(CPUSpinPredicate predicate, void* context, cpu_u64 timeout_cycles, CPUSpinLatency latency) {
+    const SpinInfo* spin = get_spin();
+    const cpu_u64 deadline = get_deadline(timeout_cycles);
+    cpu_u32 num_pauses = 1;
+    while(!predicate(context)) {
+        const cpu_u64 now = cpu_rdtsc();
+        if(now >= deadline) {
+            return LCPU_FALSE;
+        }
+        if(num_pauses < spin->max_pauses) {
+            backoff(num_pauses);
+            num_pauses <<= 1;
+            continue;
+        }
+        if(spin->has_waitpkg) {
+            // TPAUSE can't observe the predicate, so it only replaces a single backoff step
+            const cpu_u64 wakeup = now + SPIN_MAX_BACKOFF_CYCLES;
+            tpause(get_control(latency), wakeup < deadline ? wakeup : deadline);
+        }
+        else {
+            backoff(spin->max_pauses);
+        }
+    }
+    return LCPU_TRUE;
+}
+
+cpu_bool cpu_spin_until_equal(const volatile cpu_u32* address, cpu_u32 expected, cpu_u64 timeout_cycles,
+                              CPUSpinLatency latency) {
+    const SpinInfo* spin = get_spin();
+    const cpu_u64 deadline = get_deadline(timeout_cycles);
+    cpu_u32 num_pauses = 1;
+    while(*address != expected) {
+        if(cpu_rdtsc() >= deadline) {
+            return LCPU_FALSE;
+        }
+        if(num_pauses < spin->max_pauses) {
+            backoff(num_pauses);
+            num_pauses <<= 1;
+            continue;
+        }
+        if(spin->has_waitpkg) {
+            // Arm the monitor before checking again, so a write in between can't be missed
+            umonitor(address);
+            if(*address == expected) {
+                break;
+            }
+            umwait(get_control(latency), deadline);
+        }
+        else {
+            backoff(spin->max_pauses);
+        }
+    }
+    return LCPU_TRUE;
+}
+
+#endif// CPU_X86
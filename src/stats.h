@@ -0,0 +1,44 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * Scope guard which records the calls and cycles of a public function.
+ * Expands to nothing unless built with CPU_ENABLE_INSTRUMENTATION.
+ *
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#pragma once
+
+#ifdef CPU_ENABLE_INSTRUMENTATION
+
+#include "cpu/cpu_stats.h"
+#include "cpu/cpu_x86.h"
+
+typedef struct _LCPUStatsScope {
+    CPUStatsAPI api;
+    cpu_u64 start;
+} LCPUStatsScope;
+
+void lcpu_stats_record(const LCPUStatsScope* scope);
+
+// Records the scope when the enclosing function returns, no matter which return statement is taken
+#define LCPU_INSTRUMENT(api)                                                                                           \
+    const LCPUStatsScope _lcpu_stats_scope __attribute__((cleanup(lcpu_stats_record))) = {api, cpu_rdtsc_lfence()}
+
+#else// CPU_ENABLE_INSTRUMENTATION
+
+#define LCPU_INSTRUMENT(api)
+
+#endif// CPU_ENABLE_INSTRUMENTATION
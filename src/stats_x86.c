@@ -0,0 +1,110 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#if defined(CPU_X86) && defined(CPU_ENABLE_INSTRUMENTATION)
+
+#include "cpu/cpu_stats.h"
+#include "cpu/cpu_x86.h"
+#include "stats.h"
+
+// Each entry gets its own cache lines, so cores calling different functions don't contend
+typedef struct _StatsEntry {
+    alignas(64) CPUStatsEntry value;
+} StatsEntry;
+
+// NOLINTBEGIN
+static StatsEntry g_stats[CPU_STATS_API_COUNT];
+// NOLINTEND
+
+#ifdef CPU_ENABLE_INSTRUMENTATION_HISTOGRAM
+static cpu_u32 get_bucket(cpu_u64 cycles) {
+    if(cycles == 0) {
+        return 0;
+    }
+    const cpu_u32 bucket = 63 - (cpu_u32) __builtin_clzll(cycles);
+    return bucket < CPU_STATS_NUM_BUCKETS ? bucket : CPU_STATS_NUM_BUCKETS - 1;
+}
+#endif
+
+void lcpu_stats_record(const LCPUStatsScope* scope) {
+    const cpu_u64 cycles = cpu_rdtsc_lfence() - scope->start;
+    CPUStatsEntry* entry = &g_stats[scope->api].value;
+    // Locked adds, ordering against other memory accesses isn't required
+    __atomic_fetch_add(&entry->num_calls, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->num_cycles, cycles, __ATOMIC_RELAXED);
+#ifdef CPU_ENABLE_INSTRUMENTATION_HISTOGRAM
+    __atomic_fetch_add(&entry->histogram[get_bucket(cycles)], 1, __ATOMIC_RELAXED);
+#endif
+}
+
+void cpu_stats_snapshot(CPUStats* stats) {
+    for(cpu_usize api = 0; api < CPU_STATS_API_COUNT; ++api) {
+        const CPUStatsEntry* entry = &g_stats[api].value;
+        CPUStatsEntry* result = &stats->entries[api];
+        result->num_calls = __atomic_load_n(&entry->num_calls, __ATOMIC_RELAXED);
+        result->num_cycles = __atomic_load_n(&entry->num_cycles, __ATOMIC_RELAXED);
+        for(cpu_usize bucket = 0; bucket < CPU_STATS_NUM_BUCKETS; ++bucket) {
+            result->histogram[bucket] = __atomic_load_n(&entry->histogram[bucket], __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void cpu_stats_reset() {
+    for(cpu_usize api = 0; api < CPU_STATS_API_COUNT; ++api) {
+        CPUStatsEntry* entry = &g_stats[api].value;
+        __atomic_store_n(&entry->num_calls, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&entry->num_cycles, 0, __ATOMIC_RELAXED);
+        for(cpu_usize bucket = 0; bucket < CPU_STATS_NUM_BUCKETS; ++bucket) {
+            __atomic_store_n(&entry->histogram[bucket], 0, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+const char* cpu_stats_get_api_name(CPUStatsAPI api) {
+    switch(api) {// clang-format off
+        case CPU_STATS_API_GET_CPUID_LEAF:             return "cpu_get_cpuid_leaf";
+        case CPU_STATS_API_GET_GPR_WIDTH:              return "cpu_get_gpr_width";
+        case CPU_STATS_API_GET_VR_WIDTH:               return "cpu_get_vr_width";
+        case CPU_STATS_API_GET_VENDOR:                 return "cpu_get_vendor";
+        case CPU_STATS_API_VENDOR_GET_NAME:            return "cpu_vendor_get_name";
+        case CPU_STATS_API_GET_HYPERVISOR:             return "cpu_get_hypervisor";
+        case CPU_STATS_API_GET_HYPERVISOR_MAX_LEAF:    return "cpu_get_hypervisor_max_leaf";
+        case CPU_STATS_API_GET_FEATURES:               return "cpu_get_features";
+        case CPU_STATS_API_GET_ENABLED_FEATURES:       return "cpu_get_enabled_features";
+        case CPU_STATS_API_GET_AVAILABLE_FEATURES:     return "cpu_get_available_features";
+        case CPU_STATS_API_GET_NUM_AVAILABLE_FEATURES: return "cpu_get_num_available_features";
+        case CPU_STATS_API_FEATURE_GET_NAME:           return "cpu_feature_get_name";
+        case CPU_STATS_API_RESET_STATE:                return "cpu_reset_state";
+        case CPU_STATS_API_INIT:                       return "cpu_init";
+        case CPU_STATS_API_INIT_AP:                    return "cpu_init_ap";
+        case CPU_STATS_API_IS_INITIALIZED:             return "cpu_is_initialized";
+        case CPU_STATS_API_SET_EXCEPTION_HANDLER:      return "cpu_set_exception_handler";
+        case CPU_STATS_API_GET_EXCEPTION_HANDLER:      return "cpu_get_exception_handler";
+        case CPU_STATS_API_HINT_SPIN:                  return "cpu_hint_spin";
+        case CPU_STATS_API_ENTER_USERMODE:             return "cpu_enter_usermode";
+        case CPU_STATS_API_IS_USERMODE:                return "cpu_is_usermode";
+        case CPU_STATS_API_POPCNT16:                   return "cpu_popcnt16";
+        case CPU_STATS_API_POPCNT32:                   return "cpu_popcnt32";
+        case CPU_STATS_API_POPCNT64:                   return "cpu_popcnt64";
+        case CPU_STATS_API_POPCNT_BUFFER:              return "cpu_popcnt_buffer";
+        case CPU_STATS_API_POPCNT_BUFFER_AND:          return "cpu_popcnt_buffer_and";
+        default:                                       return "Unknown";
+    }// clang-format on
+}
+
+#endif// CPU_X86 && CPU_ENABLE_INSTRUMENTATION
@@ -0,0 +1,165 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define TLB_PAGE_SIZE 4096
+
+// Past this many pages, refilling the TLB after a full flush is cheaper than issuing INVLPG for each page
+#define TLB_FLUSH_CEILING 33
+
+typedef enum _TLBInvalidationType : cpu_u8 {
+    TLB_INVALIDATION_ADDRESS,           // A single address in a single PCID
+    TLB_INVALIDATION_SINGLE_CONTEXT,    // All non-global entries of a single PCID
+    TLB_INVALIDATION_ALL_CONTEXTS,      // All entries of all PCIDs, including global ones
+    TLB_INVALIDATION_ALL_CONTEXTS_LOCAL // All non-global entries of all PCIDs
+} TLBInvalidationType;
+
+typedef struct _TLBInvalidationDescriptor {
+    cpu_u64 pcid;// Only bits 11:0 are valid
+    cpu_u64 address;
+} TLBInvalidationDescriptor;
+LCPU_STATIC_ASSERT(sizeof(TLBInvalidationDescriptor) == 16, "Invalid structure size");
+
+static void invlpg(const void* address) {
+    _assemble(// clang-format off
+        _ins(_in(address)),
+        _outs(),
+        _clobs(_clob(memory)),
+        _emitI(invlpg _get(_var(address)))
+    );// clang-format on
+}
+
+static void invpcid(TLBInvalidationType type, cpu_u16 pcid, const void* address) {
+    const TLBInvalidationDescriptor descriptor = {pcid, (cpu_u64) (cpu_usize) address};
+    const TLBInvalidationDescriptor* descriptor_address = &descriptor;
+    const cpu_usize kind = type;
+    _assemble(// clang-format off
+        _ins(_in(descriptor_address), _in(kind)),
+        _outs(),
+        _clobs(_clob(memory)),
+        _emitI(invpcid _get(_var(descriptor_address)), _var(kind))
+    );// clang-format on
+}
+
+// Only flushes the non-global entries of the current PCID
+static void reload_cr3() {
+    _assemble(// clang-format off
+        _ins(),
+        _outs(),
+        _clobs(_sclob(ax), _clob(memory)),
+        _emitI(mov _reg(cr3), _sreg(ax))
+        _emitI(mov _sreg(ax), _reg(cr3))
+    );// clang-format on
+}
+
+// Any change of CR4.PGE invalidates all entries of all PCIDs, including global ones
+static void flush_all_entries() {
+    CPU_CR4 cr4;
+    lcpu_get_cr4(&cr4);
+    if(!cr4.pge && !cr4.pcide) {
+        reload_cr3();// Without global pages and PCIDs, this already drops everything
+        return;
+    }
+    cr4.pge = !cr4.pge;
+    lcpu_set_cr4(&cr4);
+    cr4.pge = !cr4.pge;
+    lcpu_set_cr4(&cr4);
+}
+
+// CR3[11:0] holds the active PCID while CR4.PCIDE is set
+static cpu_u16 get_current_pcid() {
+    cpu_usize cr3 = 0;
+    _assemble(// clang-format off
+        _ins(),
+        _outs(_out(cr3)),
+        _clobs(_clob(memory)),
+        _emitI(mov _reg(cr3), _var(cr3))
+    );// clang-format on
+    return (cpu_u16) (cr3 & 0xFFF);
+}
+
+static cpu_bool has_invpcid() {
+    return cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_INVPCID);
+}
+
+static cpu_bool is_pcid_enabled() {
+    CPU_CR4 cr4;
+    lcpu_get_cr4(&cr4);
+    return cr4.pcide;
+}
+
+void cpu_tlb_flush_page(const void* address) {
+    invlpg(address);
+}
+
+void cpu_tlb_flush_range(const void* address, cpu_usize size, cpu_bool is_global) {
+    const cpu_usize start = (cpu_usize) address & ~((cpu_usize) TLB_PAGE_SIZE - 1);
+    const cpu_usize end = (cpu_usize) address + size;
+    if((end - start + TLB_PAGE_SIZE - 1) / TLB_PAGE_SIZE > TLB_FLUSH_CEILING) {
+        if(is_global) {
+            cpu_tlb_flush_all();
+        }
+        else {
+            cpu_tlb_flush_all_nonglobal();
+        }
+        return;
+    }
+    for(cpu_usize page = start; page < end; page += TLB_PAGE_SIZE) {
+        invlpg((const void*) page);
+    }
+}
+
+void cpu_tlb_flush_pcid(cpu_u16 pcid) {
+    if(has_invpcid()) {
+        invpcid(TLB_INVALIDATION_SINGLE_CONTEXT, pcid, nullptr);
+        return;
+    }
+    if(!is_pcid_enabled() || pcid == get_current_pcid()) {
+        reload_cr3();// Everything is tagged with PCID 0 or the requested PCID is the active one
+        return;
+    }
+    flush_all_entries();// Entries of another PCID can't be singled out without INVPCID
+}
+
+void cpu_tlb_flush_all_nonglobal() {
+    if(has_invpcid()) {
+        invpcid(TLB_INVALIDATION_ALL_CONTEXTS_LOCAL, 0, nullptr);
+        return;
+    }
+    if(!is_pcid_enabled()) {
+        reload_cr3();
+        return;
+    }
+    flush_all_entries();
+}
+
+void cpu_tlb_flush_all() {
+    if(has_invpcid()) {
+        invpcid(TLB_INVALIDATION_ALL_CONTEXTS, 0, nullptr);
+        return;
+    }
+    flush_all_entries();
+}
+
+#endif// CPU_X86
@@ -0,0 +1,215 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu_x86.h"
+
+#define TOPOLOGY_LEVEL_INVALID 0
+#define TOPOLOGY_LEVEL_SMT 1
+#define TOPOLOGY_LEVEL_CORE 2
+#define TOPOLOGY_LEVEL_MODULE 3
+#define TOPOLOGY_LEVEL_TILE 4
+#define TOPOLOGY_LEVEL_DIE 5
+#define TOPOLOGY_LEVEL_DIE_GROUP 6
+
+#define TOPOLOGY_MAX_LEVELS 8
+#define TOPOLOGY_SHIFT_UNSET 0xFF
+
+// Number of bits required to hold count distinct IDs
+static cpu_u32 get_id_width(cpu_u32 count) {
+    cpu_u32 width = 0;
+    while(width < 32 && (1U << width) < count) {
+        ++width;
+    }
+    return width;
+}
+
+static cpu_u32 get_id_mask(cpu_u32 width) {
+    return width >= 32 ? 0xFFFFFFFF : (1U << width) - 1;
+}
+
+// Leaf B/1F report the number of logical processors per instance of the level starting at each shift
+static cpu_u32 find_thread_count(const cpu_u32* shifts, const cpu_u32* counts, cpu_usize num_levels, cpu_u32 shift) {
+    for(cpu_usize index = 0; index < num_levels; ++index) {
+        if(shifts[index] == shift && counts[index] != 0) {
+            return counts[index];
+        }
+    }
+    return 1U << shift;
+}
+
+static cpu_bool decode_extended_layout(CPUTopologyLayout* layout, cpu_u32 leaf) {
+    cpu_u32 shifts[TOPOLOGY_MAX_LEVELS];
+    cpu_u32 counts[TOPOLOGY_MAX_LEVELS];
+    cpu_usize num_levels = 0;
+    cpu_u32 core_shift = TOPOLOGY_SHIFT_UNSET;
+    cpu_u32 module_shift = TOPOLOGY_SHIFT_UNSET;
+    cpu_u32 die_shift = TOPOLOGY_SHIFT_UNSET;
+    for(cpu_u32 sub_leaf = 0; num_levels < TOPOLOGY_MAX_LEVELS; ++sub_leaf) {
+        CPUID value;
+        lcpu_cpuid(leaf, sub_leaf, &value);
+        const cpu_u32 type = value.ecx.leafB.type;
+        if(type == TOPOLOGY_LEVEL_INVALID) {
+            break;
+        }
+        // The shift of each level is where the ID of the next higher level starts
+        const cpu_u32 shift = value.eax.leafB.shift;
+        switch(type) {
+            case TOPOLOGY_LEVEL_SMT: core_shift = shift; break;
+            case TOPOLOGY_LEVEL_CORE: module_shift = shift; break;
+            case TOPOLOGY_LEVEL_MODULE:
+            case TOPOLOGY_LEVEL_TILE: die_shift = shift; break;// Tiles are folded into modules
+            default: break;
+        }
+        shifts[num_levels] = shift;
+        counts[num_levels] = value.ebx.leafB.num_logical;
+        ++num_levels;
+    }
+    if(num_levels == 0) {
+        return LCPU_FALSE;
+    }
+    // The last level reported always ends right below the package ID
+    const cpu_u32 package_shift = shifts[num_levels - 1];
+    if(core_shift == TOPOLOGY_SHIFT_UNSET) {
+        core_shift = 0;
+    }
+    if(module_shift == TOPOLOGY_SHIFT_UNSET) {
+        module_shift = core_shift;
+    }
+    if(die_shift == TOPOLOGY_SHIFT_UNSET) {
+        die_shift = module_shift;
+    }
+    layout->apic_id_leaf = leaf;
+    layout->core_shift = core_shift;
+    layout->module_shift = module_shift;
+    layout->die_shift = die_shift;
+    layout->package_shift = package_shift;
+    layout->threads_per_core = find_thread_count(shifts, counts, num_levels, core_shift);
+    layout->threads_per_module = find_thread_count(shifts, counts, num_levels, module_shift);
+    layout->threads_per_die = find_thread_count(shifts, counts, num_levels, die_shift);
+    layout->threads_per_package = find_thread_count(shifts, counts, num_levels, package_shift);
+    return LCPU_TRUE;
+}
+
+// AMD processors without leaf B encode [package][node][core][thread] in the extended APIC ID
+static void decode_amd_layout(CPUTopologyLayout* layout) {
+    CPUID value;
+    lcpu_cpuid(0x8000001E, 0, &value);
+    const cpu_u32 threads_per_core = value.ebx.leaf8000001E.threads_per_core + 1;
+    const cpu_u32 nodes_per_package = value.ecx.leaf8000001E.nodes_per_package + 1;
+    lcpu_cpuid(0x80000008, 0, &value);
+    const CPUID_ECX_L80000008 ecx = value.ecx.leaf80000008;
+    const cpu_u32 threads_per_package = ecx.num_threads + 1;
+    const cpu_u32 package_shift = ecx.apic_id_size != 0 ? ecx.apic_id_size : get_id_width(threads_per_package);
+    cpu_u32 node_width = get_id_width(nodes_per_package);
+    if(node_width > package_shift) {
+        node_width = package_shift;
+    }
+    layout->apic_id_leaf = 0x8000001E;
+    layout->core_shift = get_id_width(threads_per_core);
+    layout->module_shift = package_shift - node_width;
+    layout->die_shift = layout->module_shift;
+    layout->package_shift = package_shift;
+    layout->threads_per_core = threads_per_core;
+    layout->threads_per_module = threads_per_package / nodes_per_package;
+    layout->threads_per_die = layout->threads_per_module;
+    layout->threads_per_package = threads_per_package;
+}
+
+// Legacy processors only distinguish threads of a core and cores of a package
+static void decode_legacy_layout(CPUTopologyLayout* layout) {
+    CPUID value;
+    lcpu_cpuid(1, 0, &value);
+    cpu_u32 threads_per_package = 1;
+    if(value.edx.leaf1.htt && value.ebx.leaf1.max_logical_ids != 0) {
+        threads_per_package = value.ebx.leaf1.max_logical_ids;
+    }
+    lcpu_cpuid(4, 0, &value);// Reserved on AMD, which yields a single core
+    const cpu_u32 cores_per_package = value.eax.leaf4.type != 0 ? value.eax.leaf4.max_core_ids + 1 : 1;
+    cpu_u32 threads_per_core = threads_per_package / cores_per_package;
+    if(threads_per_core == 0) {
+        threads_per_core = 1;
+    }
+    const cpu_u32 package_shift = get_id_width(threads_per_package);
+    layout->apic_id_leaf = 1;
+    layout->core_shift = get_id_width(threads_per_core);
+    layout->module_shift = package_shift;
+    layout->die_shift = package_shift;
+    layout->package_shift = package_shift;
+    layout->threads_per_core = threads_per_core;
+    layout->threads_per_module = threads_per_package;
+    layout->threads_per_die = threads_per_package;
+    layout->threads_per_package = threads_per_package;
+}
+
+static const CPUTopologyLayout* get_layout() {
+    CPUInfo* info = lcpu_get_info();
+    if(cpu_atomic_load8(&info->is_topology_valid, CPU_MEMORY_ORDER_ACQUIRE)) {
+        return &info->topology;
+    }
+    CPUTopologyLayout decoded = {0};
+    CPUTopologyLayout* layout = &decoded;
+    if(!decode_extended_layout(layout, 0x1F) && !decode_extended_layout(layout, 0xB)) {
+        if(cpu_feature_set_test(&info->features, CPU_FEATURE_TOPOEXT)) {
+            decode_amd_layout(layout);
+        }
+        else {
+            decode_legacy_layout(layout);
+        }
+    }
+    lcpu_decode_lock();
+    if(!info->is_topology_valid) {
+        info->topology = decoded;
+        cpu_atomic_store8(&info->is_topology_valid, LCPU_TRUE, CPU_MEMORY_ORDER_RELEASE);
+    }
+    lcpu_decode_unlock();
+    return &info->topology;
+}
+
+cpu_u32 cpu_get_apic_id() {
+    const CPUTopologyLayout* layout = get_layout();
+    CPUID value;
+    lcpu_cpuid_uncached(layout->apic_id_leaf, 0, &value);
+    switch(layout->apic_id_leaf) {
+        case 0x1F:
+        case 0xB: return value.edx.value;
+        case 0x8000001E: return value.eax.value;
+        default: return value.ebx.leaf1.initial_apic_id;
+    }
+}
+
+CPUTopology cpu_get_topology(cpu_u32 apic_id) {
+    const CPUTopologyLayout* layout = get_layout();
+    CPUTopology topology;
+    topology.apic_id = apic_id;
+    topology.smt_id = apic_id & get_id_mask(layout->core_shift);
+    topology.core_id = (apic_id >> layout->core_shift) & get_id_mask(layout->module_shift - layout->core_shift);
+    topology.module_id = (apic_id >> layout->module_shift) & get_id_mask(layout->die_shift - layout->module_shift);
+    topology.die_id = (apic_id >> layout->die_shift) & get_id_mask(layout->package_shift - layout->die_shift);
+    topology.package_id = layout->package_shift >= 32 ? 0 : apic_id >> layout->package_shift;
+    topology.threads_per_core = layout->threads_per_core;
+    topology.threads_per_module = layout->threads_per_module;
+    topology.threads_per_die = layout->threads_per_die;
+    topology.threads_per_package = layout->threads_per_package;
+    return topology;
+}
+
+#endif// CPU_X86
@@ -0,0 +1,153 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "cpu/cpu.h"
+#include "cpu/cpu_atomic.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+
+#define TSC_NS_PER_SECOND 1000000000ULL
+#define TSC_MAX_SHIFT 32
+
+// Multiplier and shift share a single word, so readers never observe a torn pair
+typedef union _TSCScale {
+    struct {
+        cpu_u32 mult;// ns = (cycles * mult) >> shift
+        cpu_u32 shift;
+    };
+    cpu_u64 value;
+} TSCScale;
+
+typedef struct _TSCInfo {
+    volatile cpu_u64 frequency;// In Hz, 0 if unknown
+    volatile cpu_u64 scale;    // TSCScale.value
+} TSCInfo;
+
+// NOLINTBEGIN
+static TSCInfo g_tsc = {0, 0};
+static cpu_bool g_is_tsc_valid = LCPU_FALSE;
+// NOLINTEND
+
+// Picks the largest shift for which the multiplier still fits 32 bits to retain the most precision
+static TSCScale compute_scale(cpu_u64 frequency) {
+    TSCScale scale = {0};
+    if(frequency == 0) {
+        return scale;
+    }
+    for(cpu_u32 shift = TSC_MAX_SHIFT; shift > 0; --shift) {
+        // Rounded to nearest, (1e9 << 32) still fits into 64 bits
+        const cpu_u64 mult = ((TSC_NS_PER_SECOND << shift) + (frequency >> 1)) / frequency;
+        if(mult <= 0xFFFFFFFF) {
+            scale.mult = (cpu_u32) mult;
+            scale.shift = shift;
+            return scale;
+        }
+    }
+    return scale;
+}
+
+static cpu_u64 detect_frequency() {
+    CPUInfo* info = lcpu_get_info();
+    CPUID value;
+    // EAX = denominator, EBX = numerator of the TSC/crystal ratio, ECX = crystal frequency in Hz
+    lcpu_cpuid(0x15, 0, &value);
+    if(value.eax.value != 0 && value.ebx.value != 0 && value.ecx.value != 0) {
+        return ((cpu_u64) value.ecx.value * value.ebx.value) / value.eax.value;
+    }
+    // Processors without a reported crystal run the TSC at their base frequency
+    lcpu_cpuid(0x16, 0, &value);
+    if((value.eax.value & 0xFFFF) != 0) {
+        return (cpu_u64) (value.eax.value & 0xFFFF) * 1000000;
+    }
+    // KVM and VMware report the TSC frequency in kHz in their timing leaf
+    if(info->max_hv_leaf >= 0x40000010) {
+        lcpu_cpuid(0x40000010, 0, &value);
+        return (cpu_u64) value.eax.value * 1000;
+    }
+    return 0;
+}
+
+// Detection only publishes if nothing was published meanwhile, explicit frequencies always replace
+static void publish_tsc(cpu_u64 frequency, cpu_bool is_replacing) {
+    const TSCScale scale = compute_scale(frequency);
+    lcpu_decode_lock();
+    if(is_replacing || !g_is_tsc_valid) {
+        cpu_atomic_store64(&g_tsc.frequency, frequency, CPU_MEMORY_ORDER_RELAXED);
+        cpu_atomic_store64(&g_tsc.scale, scale.value, CPU_MEMORY_ORDER_RELAXED);
+        cpu_atomic_store8(&g_is_tsc_valid, LCPU_TRUE, CPU_MEMORY_ORDER_RELEASE);
+    }
+    lcpu_decode_unlock();
+}
+
+static const TSCInfo* get_tsc() {
+    if(!cpu_atomic_load8(&g_is_tsc_valid, CPU_MEMORY_ORDER_ACQUIRE)) {
+        publish_tsc(detect_frequency(), LCPU_FALSE);
+    }
+    return &g_tsc;
+}
+
+cpu_bool cpu_is_tsc_invariant() {
+    return cpu_feature_set_test(&lcpu_get_info()->features, CPU_FEATURE_INVARIANT_TSC);
+}
+
+cpu_u64 cpu_get_tsc_frequency() {
+    return cpu_atomic_load64(&get_tsc()->frequency, CPU_MEMORY_ORDER_RELAXED);
+}
+
+void cpu_set_tsc_frequency(cpu_u64 frequency) {
+    publish_tsc(frequency, LCPU_TRUE);
+}
+
+cpu_u64 cpu_calibrate_tsc(CPUTimeSource time_source, cpu_u64 duration_ns) {
+    if(duration_ns == 0) {
+        duration_ns = 1;// Wait for at least one tick of the reference clock
+    }
+    // Align to a tick of the reference clock so its granularity doesn't skew the result
+    const cpu_u64 previous_time = time_source();
+    cpu_u64 start_time = time_source();
+    while(start_time == previous_time) {
+        start_time = time_source();
+    }
+    const cpu_u64 start_cycles = cpu_rdtsc_lfence();
+    cpu_u64 end_time = start_time;
+    while(end_time - start_time < duration_ns) {
+        cpu_hint_spin();
+        end_time = time_source();
+    }
+    const cpu_u64 end_cycles = cpu_rdtsc_lfence();
+    const cpu_u64 elapsed_ns = end_time - start_time;
+    const cpu_u64 elapsed_cycles = end_cycles - start_cycles;
+    // Split the scaling so it doesn't overflow for calibrations of several seconds
+    const cpu_u64 frequency = (elapsed_cycles / elapsed_ns) * TSC_NS_PER_SECOND +
+                              ((elapsed_cycles % elapsed_ns) * TSC_NS_PER_SECOND) / elapsed_ns;
+    cpu_set_tsc_frequency(frequency);
+    return frequency;
+}
+
+cpu_u64 cpu_cycles_to_ns(cpu_u64 cycles) {
+    TSCScale scale;
+    scale.value = cpu_atomic_load64(&get_tsc()->scale, CPU_MEMORY_ORDER_RELAXED);
+    // 64x32 bit multiplication with a 96 bit intermediate, split into two halves
+    const cpu_u64 low = ((cycles & 0xFFFFFFFF) * scale.mult) >> scale.shift;
+    const cpu_u64 high = (cycles >> 32) * scale.mult;
+    return low + (scale.shift == 32 ? high : high << (32 - scale.shift));
+}
+
+#endif// CPU_X86
@@ -19,24 +19,17 @@
 #pragma once
 
 // clang-format off
-#define CALL_IF_ENABLED(value, mask, fn, ...) \
-    do {                                      \
-        if(((value) & (mask)) == (mask)) {    \
-            fn(__VA_ARGS__);                  \
-        }                                     \
+#define CALL_IF_ENABLED(set, feature, fn, ...)      \
+    do {                                            \
+        if(cpu_feature_set_test(&(set), feature)) { \
+            fn(__VA_ARGS__);                        \
+        }                                           \
     } while(0)
 
-#define RETURN_IF_MATCH(addr1, addr2, size, ...) \
-    do {                                         \
-        if(LCPU_MEMCMP(addr1, addr2, size)) {    \
-            return __VA_ARGS__;                  \
-        }                                        \
-    } while(0)
-
-#define SET_BIT_IF(value, bitmask, bit) \
-    do {                                \
-        if(value) {                     \
-            bitmask |= bit;             \
-        }                               \
+#define SET_FEATURE_IF(value, set, feature)       \
+    do {                                          \
+        if(value) {                               \
+            cpu_feature_set_set(&(set), feature); \
+        }                                         \
     } while(0)
 // clang-format on
\ No newline at end of file
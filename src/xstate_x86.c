@@ -0,0 +1,222 @@
+// Copyright 2023 Karma Krafts & associates
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/**
+ * @author Alexander Hinze
+ * @since 18/10/2026
+ */
+
+#ifdef CPU_X86
+
+#include "assembler.h"
+#include "cpu/cpu.h"
+#include "cpu/cpu_x86.h"
+#include "cpu_x86.h"
+#include "memory.h"
+
+#define XSTATE_LEGACY_SIZE 512// FXSAVE area, also the start of every XSAVE area
+#define XSTATE_HEADER_SIZE 64
+#define XSTATE_FIRST_EXTENDED 2// Components 0 and 1 live in the legacy area
+#define XSTATE_MAX_COMPONENTS 63
+
+// The 64-bit forms also save the full 64-bit FPU instruction and data pointers
+#ifdef CPU_64_BIT
+#define XSTATE_INSN(n) n##64
+#else
+#define XSTATE_INSN(n) n
+#endif
+
+typedef enum _XStateMethod : cpu_u8 {
+    XSTATE_METHOD_NONE,
+    XSTATE_METHOD_FXSAVE,
+    XSTATE_METHOD_XSAVE,
+    XSTATE_METHOD_XSAVEOPT,// Standard format, skips components in their init state or unmodified since XRSTOR
+    XSTATE_METHOD_XSAVEC,  // Compacted format, skips components in their init state
+    XSTATE_METHOD_XSAVES   // Compacted format, skips both like XSAVEOPT, kernel mode only
+} XStateMethod;
+
+typedef struct _XStateInfo {
+    XStateMethod method;
+    cpu_u64 mask;  // Enabled XCR0 components
+    cpu_usize size;// Save area size for the selected method
+} XStateInfo;
+
+// NOLINTBEGIN
+static XStateInfo g_xstate = {XSTATE_METHOD_NONE, 0, 0};
+// NOLINTEND
+
+// clang-format off
+#define DEFINE_XSTATE_SAVE(n)                                   \
+    static void n(void* area, cpu_u64 mask) {                   \
+        const cpu_u32 low = (cpu_u32) mask;                     \
+        const cpu_u32 high = (cpu_u32) (mask >> 32);            \
+        _assemble(                                              \
+            _ins(_in(area), _in(low), _in(high)),               \
+            _outs(),                                            \
+            _clobs(_clob(eax), _clob(edx), _clob(memory)),      \
+            _emitI(mov _var(low), _reg(eax))                    \
+            _emitI(mov _var(high), _reg(edx))                   \
+            _emitI(XSTATE_INSN(n) _get(_var(area)))             \
+        );                                                      \
+    }
+
+#define DEFINE_XSTATE_RESTORE(n)                                \
+    static void n(const void* area, cpu_u64 mask) {             \
+        const cpu_u32 low = (cpu_u32) mask;                     \
+        const cpu_u32 high = (cpu_u32) (mask >> 32);            \
+        _assemble(                                              \
+            _ins(_in(area), _in(low), _in(high)),               \
+            _outs(),                                            \
+            _clobs(_clob(eax), _clob(edx), _clob(memory)),      \
+            _emitI(mov _var(low), _reg(eax))                    \
+            _emitI(mov _var(high), _reg(edx))                   \
+            _emitI(XSTATE_INSN(n) _get(_var(area)))             \
+        );                                                      \
+    }
+// clang-format on
+
+DEFINE_XSTATE_SAVE(xsave)
+DEFINE_XSTATE_SAVE(xsaveopt)
+DEFINE_XSTATE_SAVE(xsavec)
+DEFINE_XSTATE_SAVE(xsaves)
+DEFINE_XSTATE_RESTORE(xrstor)
+DEFINE_XSTATE_RESTORE(xrstors)
+
+static void fxsave(void* area) {
+    _assemble(// clang-format off
+        _ins(_in(area)),
+        _outs(),
+        _clobs(_clob(memory)),
+        _emitI(XSTATE_INSN(fxsave) _get(_var(area)))
+    );// clang-format on
+}
+
+static void fxrstor(const void* area) {
+    _assemble(// clang-format off
+        _ins(_in(area)),
+        _outs(),
+        _clobs(_clob(memory)),
+        _emitI(XSTATE_INSN(fxrstor) _get(_var(area)))
+    );// clang-format on
+}
+
+static cpu_u64 get_xcr0_mask() {
+    CPU_XCR0 xcr0;
+    lcpu_get_xcr0(&xcr0);
+    cpu_u64 mask = 0;
+    LCPU_MEMCPY(&mask, &xcr0, sizeof(CPU_XCR0));
+    return mask;
+}
+
+// Leaf 0xD sub-leaf 0 only reports the standard size for the XCR0 at the time it was executed,
+// so both sizes are derived from the static per-component sub-leaves instead
+static cpu_usize get_standard_size(cpu_u64 mask) {
+    cpu_usize size = XSTATE_LEGACY_SIZE + XSTATE_HEADER_SIZE;
+    for(cpu_u32 index = XSTATE_FIRST_EXTENDED; index < XSTATE_MAX_COMPONENTS; ++index) {
+        if((mask & (1ULL << index)) == 0) {
+            continue;
+        }
+        CPUID value;
+        lcpu_cpuid(0xD, index, &value);
+        const cpu_usize end = (cpu_usize) value.ebx.value + value.eax.value;
+        if(end > size) {
+            size = end;
+        }
+    }
+    return size;
+}
+
+// The compacted format packs enabled components in order, some of them aligned to 64 bytes
+static cpu_usize get_compacted_size(cpu_u64 mask) {
+    cpu_usize size = XSTATE_LEGACY_SIZE + XSTATE_HEADER_SIZE;
+    for(cpu_u32 index = XSTATE_FIRST_EXTENDED; index < XSTATE_MAX_COMPONENTS; ++index) {
+        if((mask & (1ULL << index)) == 0) {
+            continue;
+        }
+        CPUID value;
+        lcpu_cpuid(0xD, index, &value);
+        if(value.ecx.leafD.aligned) {
+            size = (size + CPU_XSTATE_ALIGNMENT - 1) & ~((cpu_usize) CPU_XSTATE_ALIGNMENT - 1);
+        }
+        size += value.eax.value;
+    }
+    return size;
+}
+
+static XStateMethod select_method(const CPUFeatureSet* features) {
+    const CPUFeatureSet* detected = &lcpu_get_info()->features;
+    // XSAVE may already have been enabled by the OS or firmware without cpu_init()
+    if(cpu_feature_set_test(features, CPU_FEATURE_XSAVE) || cpu_feature_set_test(detected, CPU_FEATURE_OSXSAVE)) {
+        if(cpu_feature_set_test(detected, CPU_FEATURE_XSAVES) && !cpu_is_usermode()) {
+            return XSTATE_METHOD_XSAVES;
+        }
+        if(cpu_feature_set_test(detected, CPU_FEATURE_XSAVEC)) {
+            return XSTATE_METHOD_XSAVEC;
+        }
+        if(cpu_feature_set_test(detected, CPU_FEATURE_XSAVEOPT)) {
+            return XSTATE_METHOD_XSAVEOPT;
+        }
+        return XSTATE_METHOD_XSAVE;
+    }
+    if(cpu_feature_set_test(detected, CPU_FEATURE_FXSR)) {
+        return XSTATE_METHOD_FXSAVE;
+    }
+    return XSTATE_METHOD_NONE;
+}
+
+void lcpu_xstate_init(const CPUFeatureSet* features) {
+    XStateInfo xstate = {select_method(features), 0, 0};
+    switch(xstate.method) {
+        case XSTATE_METHOD_NONE: break;
+        case XSTATE_METHOD_FXSAVE: xstate.size = XSTATE_LEGACY_SIZE; break;
+        case XSTATE_METHOD_XSAVE:
+        case XSTATE_METHOD_XSAVEOPT:
+            xstate.mask = get_xcr0_mask();
+            xstate.size = get_standard_size(xstate.mask);
+            break;
+        case XSTATE_METHOD_XSAVEC:
+        case XSTATE_METHOD_XSAVES:
+            xstate.mask = get_xcr0_mask();// Supervisor components in IA32_XSS are left to the caller
+            xstate.size = get_compacted_size(xstate.mask);
+            break;
+    }
+    g_xstate = xstate;
+}
+
+cpu_usize cpu_xstate_alloc_size() {
+    return g_xstate.size;
+}
+
+void cpu_xstate_save(void* area) {
+    switch(g_xstate.method) {
+        case XSTATE_METHOD_NONE: break;
+        case XSTATE_METHOD_FXSAVE: fxsave(area); break;
+        case XSTATE_METHOD_XSAVE: xsave(area, g_xstate.mask); break;
+        case XSTATE_METHOD_XSAVEOPT: xsaveopt(area, g_xstate.mask); break;
+        case XSTATE_METHOD_XSAVEC: xsavec(area, g_xstate.mask); break;
+        case XSTATE_METHOD_XSAVES: xsaves(area, g_xstate.mask); break;
+    }
+}
+
+void cpu_xstate_restore(const void* area) {
+    switch(g_xstate.method) {
+        case XSTATE_METHOD_NONE: break;
+        case XSTATE_METHOD_FXSAVE: fxrstor(area); break;
+        case XSTATE_METHOD_XSAVE:
+        case XSTATE_METHOD_XSAVEOPT:
+        case XSTATE_METHOD_XSAVEC: xrstor(area, g_xstate.mask); break;
+        case XSTATE_METHOD_XSAVES: xrstors(area, g_xstate.mask); break;
+    }
+}
+
+#endif// CPU_X86
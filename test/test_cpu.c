@@ -17,6 +17,9 @@
  */
 
 #include <cpu/cpu.h>
+#include <cpu/cpu_atomic.h>
+#include <cpu/cpu_stats.h>
+#include <cpu/cpu_x86.h>
 #include <efitest/efitest.h>
 #include <efitest/efitest_utils.h>
 
@@ -33,36 +36,293 @@ ETEST_DEFINE_TEST(test_vendor_get_name) {
     efitest_logln(L"Detected CPU vendor: %a", name);
 }
 
+ETEST_DEFINE_TEST(test_get_hypervisor) {
+    const CPUFeatureSet features = cpu_get_features();
+    if(!cpu_feature_set_test(&features, CPU_FEATURE_HYPERVISOR)) {
+        ETEST_ASSERT_EQ(cpu_get_hypervisor(), CPU_VENDOR_UNKNOWN);
+        ETEST_ASSERT_EQ(cpu_get_hypervisor_max_leaf(), 0);
+        return;
+    }
+    ETEST_ASSERT_EQ(cpu_get_hypervisor_max_leaf() >= 0x40000000, LCPU_TRUE);
+    efitest_logln(L"Detected hypervisor: %a", cpu_vendor_get_name(cpu_get_hypervisor()));
+}
+
+ETEST_DEFINE_TEST(test_kvm_features) {
+    if(cpu_get_hypervisor() != CPU_VENDOR_KVM) {
+        ETEST_ASSERT_EQ(cpu_kvm_has_feature(CPU_KVM_FEATURE_CLOCKSOURCE2), LCPU_FALSE);
+        ETEST_ASSERT_EQ(cpu_kvm_pvclock_init(0), LCPU_FALSE);
+        ETEST_ASSERT_EQ(cpu_kvm_steal_time_init(0), LCPU_FALSE);
+        return;
+    }
+    static CPUKVMPVClock clock;
+    if(cpu_kvm_pvclock_init((cpu_u64) &clock)) {// Identity mapped under UEFI
+        const cpu_u64 start = cpu_kvm_pvclock_read(&clock);
+        ETEST_ASSERT_EQ(cpu_kvm_pvclock_read(&clock) >= start, LCPU_TRUE);
+    }
+}
+
 ETEST_DEFINE_TEST(test_get_features) {
-    const CPUFeature features = cpu_get_features();
-    ETEST_ASSERT_NE(features, CPU_FEATURE_NONE);
+    const CPUFeatureSet features = cpu_get_features();
+    ETEST_ASSERT_EQ(cpu_feature_set_is_empty(&features), LCPU_FALSE);
 
-    const cpu_usize num_features = cpu_popcnt32((cpu_u32) features);
     const CPUFeature* all_features = cpu_get_available_features();
     const cpu_usize num_all_features = cpu_get_num_available_features();
-    cpu_usize last_feat_index = 1;
 
     efitest_log(ETEST_SPACER L" Detected CPU features: ");
-    for(cpu_usize index = 0; index < num_features; ++index) {
-        for(cpu_usize feat_index = last_feat_index; feat_index < num_all_features; ++feat_index) {
-            const CPUFeature feature = all_features[feat_index];
-            if((features & feature) == feature) {
-                efitest_log(L"| %a ", cpu_feature_get_name(feature));
-                last_feat_index = feat_index + 1;
-                goto outer_end;
-            }
+    for(cpu_usize index = 0; index < num_all_features; ++index) {
+        const CPUFeature feature = all_features[index];
+        if(cpu_feature_set_test(&features, feature)) {
+            efitest_log(L"| %a ", cpu_feature_get_name(feature));
         }
-    outer_end:
     }
     efitest_log(L"|\n");
 }
 
+ETEST_DEFINE_TEST(test_feature_set) {
+    CPUFeatureSet set1 = {0};
+    CPUFeatureSet set2 = {0};
+    ETEST_ASSERT_EQ(cpu_feature_set_is_empty(&set1), LCPU_TRUE);
+    cpu_feature_set_set(&set1, CPU_FEATURE_SSE2);
+    cpu_feature_set_set(&set1, CPU_FEATURE_AVX512VPOPCNTDQ);
+    cpu_feature_set_set(&set2, CPU_FEATURE_AVX512VPOPCNTDQ);
+    cpu_feature_set_set(&set2, CPU_FEATURE_WBNOINVD);
+    ETEST_ASSERT_EQ(cpu_feature_set_count(&set1), 2);
+    ETEST_ASSERT_EQ(cpu_feature_set_test(&set1, CPU_FEATURE_SSE2), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_feature_set_test(&set1, CPU_FEATURE_WBNOINVD), LCPU_FALSE);
+
+    CPUFeatureSet intersection;
+    cpu_feature_set_intersect(&intersection, &set1, &set2);
+    ETEST_ASSERT_EQ(cpu_feature_set_count(&intersection), 1);
+    ETEST_ASSERT_EQ(cpu_feature_set_test(&intersection, CPU_FEATURE_AVX512VPOPCNTDQ), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_feature_set_contains(&set1, &intersection), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_feature_set_contains(&intersection, &set1), LCPU_FALSE);
+
+    cpu_feature_set_clear(&set1, CPU_FEATURE_SSE2);
+    ETEST_ASSERT_EQ(cpu_feature_set_equals(&set1, &intersection), LCPU_TRUE);
+}
+
+ETEST_DEFINE_TEST(test_feature_get_name) {
+    const CPUFeature* all_features = cpu_get_available_features();
+    const cpu_usize num_all_features = cpu_get_num_available_features();
+    ETEST_ASSERT_GT(num_all_features, 0);
+    for(cpu_usize index = 0; index < num_all_features; ++index) {
+        ETEST_ASSERT_GT(strlen(cpu_feature_get_name(all_features[index])), 0);
+    }
+}
+
+ETEST_DEFINE_TEST(test_get_cache_info) {
+    const CPUCacheInfo* cache_info = cpu_get_cache_info();
+    ETEST_ASSERT_GT(cache_info->num_caches, 0);
+    for(cpu_usize index = 0; index < cache_info->num_caches; ++index) {
+        const CPUCache* cache = &cache_info->caches[index];
+        ETEST_ASSERT_GT(cache->level, 0);
+        ETEST_ASSERT_GT(cache->line_size, 0);
+        ETEST_ASSERT_GT(cache->num_sharing, 0);
+        ETEST_ASSERT_EQ(cache->size % ((cpu_usize) cache->line_size * cache->associativity), 0);
+        efitest_logln(L"L%u %a: %lu bytes, %u-way, %u sets, shared by %u", cache->level,
+                      cache->type == CPU_CACHE_TYPE_INSTRUCTION ? "instruction"
+                      : cache->type == CPU_CACHE_TYPE_DATA      ? "data"
+                                                                : "unified",
+                      (cpu_u64) cache->size, cache->associativity, cache->num_sets, cache->num_sharing);
+    }
+    const CPUCache* l1d = cpu_get_cache(1, CPU_CACHE_TYPE_DATA);
+    ETEST_ASSERT_NE(l1d, nullptr);
+    ETEST_ASSERT_EQ(cpu_get_cacheline_size(), l1d->line_size);
+}
+
+ETEST_DEFINE_TEST(test_get_topology) {
+    const cpu_u32 apic_id = cpu_get_apic_id();
+    const CPUTopology topology = cpu_get_topology(apic_id);
+    ETEST_ASSERT_EQ(topology.apic_id, apic_id);
+    ETEST_ASSERT_GT(topology.threads_per_core, 0);
+    ETEST_ASSERT_GT(topology.threads_per_module + 1, topology.threads_per_core);
+    ETEST_ASSERT_GT(topology.threads_per_die + 1, topology.threads_per_module);
+    ETEST_ASSERT_GT(topology.threads_per_package + 1, topology.threads_per_die);
+    efitest_logln(L"APIC ID %u: package %u, die %u, module %u, core %u, thread %u", apic_id, topology.package_id,
+                  topology.die_id, topology.module_id, topology.core_id, topology.smt_id);
+}
+
+ETEST_DEFINE_TEST(test_get_cpuid_leaf) {
+    const CPUIDLeaf leaf = cpu_get_cpuid_leaf(0, 0);
+    ETEST_ASSERT_GT(leaf.eax, 0);
+    const CPUIDLeaf cached_leaf = cpu_get_cpuid_leaf(0, 0);
+    ETEST_ASSERT_EQ(cached_leaf.eax, leaf.eax);
+    ETEST_ASSERT_EQ(cached_leaf.ebx, leaf.ebx);
+    ETEST_ASSERT_EQ(cached_leaf.ecx, leaf.ecx);
+    ETEST_ASSERT_EQ(cached_leaf.edx, leaf.edx);
+    // Leaves beyond the supported range read as zero
+    const CPUIDLeaf invalid_leaf = cpu_get_cpuid_leaf(leaf.eax + 1, 0);
+    ETEST_ASSERT_EQ(invalid_leaf.eax, 0);
+}
+
+ETEST_DEFINE_TEST(test_tsc) {
+    const cpu_u64 start = cpu_rdtsc_lfence();
+    ETEST_ASSERT_GT(cpu_rdtscp(nullptr), start);
+    ETEST_ASSERT_GT(cpu_rdtsc_mfence(), start);
+    const cpu_u64 frequency = cpu_get_tsc_frequency();
+    efitest_logln(L"TSC: %lu Hz, invariant: %u", frequency, cpu_is_tsc_invariant());
+    cpu_set_tsc_frequency(1000000000);
+    ETEST_ASSERT_EQ(cpu_cycles_to_ns(123456789), 123456789);
+    cpu_set_tsc_frequency(2000000000);
+    ETEST_ASSERT_EQ(cpu_cycles_to_ns(2000), 1000);
+    ETEST_ASSERT_EQ(cpu_cycles_to_ns(2000000000000), 1000000000000);
+    cpu_set_tsc_frequency(frequency);
+}
+
+ETEST_DEFINE_TEST(test_current_id) {
+    ETEST_ASSERT_EQ(cpu_current_id(), cpu_get_apic_id());
+}
+
+#ifdef CPU_64_BIT
+typedef struct _TestPerCPU {
+    CPUPerCPUHeader header;
+    cpu_u64 counter;
+    cpu_u32 value;
+} TestPerCPU;
+
+ETEST_DEFINE_TEST(test_percpu) {
+    static TestPerCPU percpu;
+    ETEST_ASSERT_EQ(cpu_percpu_init(&percpu, sizeof(CPUPerCPUHeader) - 1), LCPU_FALSE);
+    ETEST_ASSERT_EQ(cpu_percpu_init(&percpu, sizeof(TestPerCPU)), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_percpu_get_base(), &percpu);
+    cpu_percpu_write64(__builtin_offsetof(TestPerCPU, counter), 42);
+    cpu_percpu_write32(__builtin_offsetof(TestPerCPU, value), 7);
+    ETEST_ASSERT_EQ(percpu.counter, 42);
+    ETEST_ASSERT_EQ(cpu_percpu_read32(__builtin_offsetof(TestPerCPU, value)), 7);
+    ETEST_ASSERT_EQ(cpu_current_id(), percpu.header.id);
+    const CPUFeatureSet features = cpu_get_features();
+    if(cpu_feature_set_test(&features, CPU_FEATURE_RDPID) || cpu_feature_set_test(&features, CPU_FEATURE_RDTSCP)) {
+        // What a processor which didn't run cpu_percpu_init() sees, TSC_AUX != APIC ID
+        cpu_wrmsr(0xC0000103, percpu.header.id + 1);
+        ETEST_ASSERT_EQ(cpu_current_id(), cpu_get_apic_id());
+        ETEST_ASSERT_EQ(cpu_percpu_init(&percpu, sizeof(TestPerCPU)), LCPU_TRUE);
+        ETEST_ASSERT_EQ(cpu_current_id(), cpu_get_apic_id());
+    }
+}
+#endif
+
 ETEST_DEFINE_TEST(test_init) {
-    const CPUFeature features = cpu_get_features();
-    ETEST_ASSERT_NE(features, CPU_FEATURE_NONE);
+    const CPUFeatureSet features = cpu_get_features();
+    ETEST_ASSERT_EQ(cpu_feature_set_is_empty(&features), LCPU_FALSE);
     cpu_init(features);
-    ETEST_ASSERT_EQ(cpu_get_enabled_features(), features);
+    const CPUFeatureSet enabled_features = cpu_get_enabled_features();
+    // Features whose register state couldn't be enabled are dropped
+    ETEST_ASSERT_EQ(cpu_feature_set_contains(&features, &enabled_features), LCPU_TRUE);
+    if(cpu_feature_set_test(&enabled_features, CPU_FEATURE_AVX512)) {
+        __asm__ __volatile__("kxorw %k1, %k1, %k1");// Raises #UD unless the opmask state is enabled
+    }
+    ETEST_ASSERT_EQ(cpu_is_initialized(), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_init_ap(), LCPU_TRUE);// Replays the configuration on an initialized core
+}
+
+ETEST_DEFINE_TEST(test_power_caps) {
+    const CPUPowerCaps caps = cpu_get_power_caps();
+    if(!caps.has_hwp) {
+        ETEST_ASSERT_EQ(cpu_set_perf_preference(0, 0, 0), LCPU_FALSE);
+        return;
+    }
+    ETEST_ASSERT_EQ(caps.lowest_perf <= caps.highest_perf, LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_set_perf_preference(caps.lowest_perf, caps.highest_perf, 128), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_set_perf_preference(caps.highest_perf, caps.lowest_perf, 0), caps.lowest_perf == caps.highest_perf);
+}
+
+ETEST_DEFINE_TEST(test_msr_probe) {
+    ETEST_ASSERT_EQ(cpu_msr_apply(nullptr, 0), 0);
+    const CPUFeatureSet features = cpu_get_features();
+    if(!cpu_feature_set_test(&features, CPU_FEATURE_MSR) || cpu_is_usermode()) {
+        ETEST_ASSERT_EQ(cpu_msr_probe(0x10, nullptr), LCPU_FALSE);
+        return;
+    }
+    cpu_u64 tsc = 0;
+    ETEST_ASSERT_EQ(cpu_msr_probe(0x10, &tsc), LCPU_TRUE);// IA32_TIME_STAMP_COUNTER
+    ETEST_ASSERT_GT(tsc, 0);
+    ETEST_ASSERT_GT(cpu_rdmsr(0x10), tsc);
+}
+
+ETEST_DEFINE_TEST(test_pmu) {
+    const CPUPMUInfo info = cpu_pmu_get_info();
+    ETEST_ASSERT_EQ(cpu_pmu_configure(info.num_counters, CPU_PMU_EVENT_CORE_CYCLES, CPU_PMU_COUNT_ALL), LCPU_FALSE);
+    if(info.num_counters == 0 || (info.events & (1U << CPU_PMU_EVENT_INSTRUCTIONS_RETIRED)) == 0 ||
+       cpu_is_usermode()) {
+        return;
+    }
+    ETEST_ASSERT_GT(info.counter_width, 0);
+    ETEST_ASSERT_EQ(cpu_pmu_configure(0, CPU_PMU_EVENT_INSTRUCTIONS_RETIRED, CPU_PMU_COUNT_ALL), LCPU_TRUE);
+    const cpu_u64 start = cpu_pmu_read(0);
+    ETEST_ASSERT_GT(cpu_pmu_read(0), start);
+    ETEST_ASSERT_EQ(cpu_pmu_configure(0, CPU_PMU_EVENT_INSTRUCTIONS_RETIRED, CPU_PMU_COUNT_NONE), LCPU_TRUE);
+}
+
+ETEST_DEFINE_TEST(test_cache_flush_range) {
+    static cpu_u8 buffer[4096];
+    cpu_memset(buffer, 0xAB, sizeof(buffer));
+    cpu_prefetch(buffer, CPU_PREFETCH_LOCALITY_HIGH);
+    cpu_prefetchw(buffer + sizeof(buffer) / 2);
+    cpu_cache_flush_range(buffer + 1, sizeof(buffer) - 1);
+    cpu_cache_writeback_range(buffer, sizeof(buffer));
+    ETEST_ASSERT_EQ(buffer[0], 0xAB);
+    ETEST_ASSERT_EQ(buffer[sizeof(buffer) - 1], 0xAB);
+}
+
+ETEST_DEFINE_TEST(test_tlb_flush) {
+    if(cpu_is_usermode()) {
+        return;
+    }
+    static cpu_u8 buffer[4096 * 64];
+    buffer[0] = 0x12;
+    cpu_tlb_flush_page(buffer);
+    cpu_tlb_flush_range(buffer, 4096 * 4, LCPU_FALSE);
+    cpu_tlb_flush_range(buffer, sizeof(buffer), LCPU_FALSE);
+    cpu_tlb_flush_pcid(0);
+    cpu_tlb_flush_all();
+    ETEST_ASSERT_EQ(buffer[0], 0x12);
+}
+
+ETEST_DEFINE_TEST(test_memory_types) {
+    cpu_u64 bits = ~0ULL;
+    ETEST_ASSERT_EQ(cpu_pat_get_pte_bits(CPU_MEMORY_TYPE_WB, LCPU_FALSE, &bits), LCPU_TRUE);
+    ETEST_ASSERT_EQ(bits, 0);
+    ETEST_ASSERT_EQ(cpu_pat_get_pte_bits(CPU_MEMORY_TYPE_UC, LCPU_TRUE, &bits), LCPU_TRUE);
+    ETEST_ASSERT_EQ(bits, 0x18);// PCD | PWT
+    CPUMTRRInfo info;
+    if(!cpu_mtrr_get_info(&info)) {
+        ETEST_ASSERT_EQ(cpu_mtrr_get_ranges(nullptr, 0), 0);
+        return;
+    }
+    CPUMTRRRange ranges[8];
+    const cpu_usize count = cpu_mtrr_get_ranges(ranges, 8);
+    ETEST_ASSERT_EQ(count <= info.num_variable, LCPU_TRUE);
+    for(cpu_usize index = 0; index < count && index < 8; ++index) {
+        ETEST_ASSERT_NE(ranges[index].size, 0);
+        ETEST_ASSERT_EQ(ranges[index].base & (ranges[index].size - 1), 0);
+    }
+}
+
+ETEST_DEFINE_TEST(test_xstate) {
+    static alignas(CPU_XSTATE_ALIGNMENT) cpu_u8 area[16384];
+    const cpu_usize size = cpu_xstate_alloc_size();
+    ETEST_ASSERT_GT(size, 0);
+    ETEST_ASSERT_EQ(size <= sizeof(area), LCPU_TRUE);
+    cpu_xstate_save(area);
+    cpu_xstate_restore(area);
+}
+
+#ifdef CPU_ENABLE_INSTRUMENTATION
+ETEST_DEFINE_TEST(test_stats) {
+    cpu_stats_reset();
+    for(cpu_usize index = 0; index < 3; ++index) {
+        cpu_get_vendor();
+    }
+    CPUStats stats;
+    cpu_stats_snapshot(&stats);
+    ETEST_ASSERT_EQ(stats.entries[CPU_STATS_API_GET_VENDOR].num_calls, 3);
+    ETEST_ASSERT_GT(stats.entries[CPU_STATS_API_GET_VENDOR].num_cycles, 0);
+    ETEST_ASSERT_EQ(stats.entries[CPU_STATS_API_INIT].num_calls, 0);
+    cpu_stats_reset();
+    cpu_stats_snapshot(&stats);
+    ETEST_ASSERT_EQ(stats.entries[CPU_STATS_API_GET_VENDOR].num_calls, 0);
 }
+#endif
 
 ETEST_DEFINE_TEST(test_hint_spin) {
     for(int index = 0; index < 10000000; ++index) {
@@ -70,6 +330,79 @@ ETEST_DEFINE_TEST(test_hint_spin) {
     }
 }
 
+ETEST_DEFINE_TEST(test_idle) {
+    const CPUMwaitInfo* mwait_info = cpu_get_mwait_info();
+    if(mwait_info != nullptr) {
+        ETEST_ASSERT_GT(mwait_info->max_monitor_size + 1, mwait_info->min_monitor_size);
+    }
+    ETEST_ASSERT_EQ(cpu_get_mwait_hint(CPU_IDLE_HINT_SHALLOW), 0);
+    efitest_logln(L"Deepest MWAIT hint: 0x%02X", cpu_get_mwait_hint(CPU_IDLE_HINT_DEEP));
+    cpu_idle(CPU_IDLE_HINT_SHALLOW);// Woken up by the firmware timer
+}
+
+ETEST_DEFINE_TEST(test_wait_on_address) {
+    alignas(8) volatile cpu_u64 value = 1;
+    ETEST_ASSERT_EQ(cpu_wait_on_address(&value, 2, CPU_SPIN_FOREVER), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_wait_on_address(&value, 1, cpu_rdtsc() + 100000), LCPU_FALSE);
+}
+
+static cpu_bool spin_predicate(void* context) {
+    cpu_u32* count = (cpu_u32*) context;
+    return ++*count >= 16;
+}
+
+ETEST_DEFINE_TEST(test_spin_until) {
+    cpu_u32 count = 0;
+    ETEST_ASSERT_EQ(cpu_spin_until(spin_predicate, &count, CPU_SPIN_FOREVER, CPU_SPIN_LATENCY_LOW), LCPU_TRUE);
+    ETEST_ASSERT_EQ(count, 16);
+    const volatile cpu_u32 value = 1;
+    ETEST_ASSERT_EQ(cpu_spin_until_equal(&value, 1, 0, CPU_SPIN_LATENCY_HIGH), LCPU_TRUE);
+    const cpu_u64 start = cpu_rdtsc_lfence();
+    ETEST_ASSERT_EQ(cpu_spin_until_equal(&value, 2, 100000, CPU_SPIN_LATENCY_LOW), LCPU_FALSE);
+    ETEST_ASSERT_GT(cpu_rdtsc_lfence() - start, 99999);
+}
+
+ETEST_DEFINE_TEST(test_atomic) {
+    volatile cpu_u32 value = 1;
+    ETEST_ASSERT_EQ(cpu_atomic_fetch_add32(&value, 2, CPU_MEMORY_ORDER_RELAXED), 1);
+    ETEST_ASSERT_EQ(cpu_atomic_exchange32(&value, 5, CPU_MEMORY_ORDER_ACQ_REL), 3);
+    cpu_u32 expected = 4;
+    ETEST_ASSERT_EQ(cpu_atomic_compare_exchange32(&value, &expected, 6, CPU_MEMORY_ORDER_SEQ_CST), LCPU_FALSE);
+    ETEST_ASSERT_EQ(expected, 5);
+    ETEST_ASSERT_EQ(cpu_atomic_compare_exchange32(&value, &expected, 6, CPU_MEMORY_ORDER_RELEASE), LCPU_TRUE);
+    ETEST_ASSERT_EQ(cpu_atomic_load32(&value, CPU_MEMORY_ORDER_ACQUIRE), 6);
+#ifdef CPU_64_BIT
+    const CPUFeatureSet features = cpu_get_features();
+    if(cpu_feature_set_test(&features, CPU_FEATURE_CX16)) {
+        volatile CPUAtomic128 wide = {1, 2};
+        CPUAtomic128 expected_wide = {1, 2};
+        ETEST_ASSERT_EQ(cpu_atomic_compare_exchange128(&wide, &expected_wide, (CPUAtomic128){3, 4}), LCPU_TRUE);
+        ETEST_ASSERT_EQ(cpu_atomic_compare_exchange128(&wide, &expected_wide, (CPUAtomic128){5, 6}), LCPU_FALSE);
+        ETEST_ASSERT_EQ(expected_wide.low, 3);
+        ETEST_ASSERT_EQ(expected_wide.high, 4);
+    }
+#endif
+}
+
+ETEST_DEFINE_TEST(test_spinlocks) {
+    CPUTicketLock ticket_lock = CPU_TICKET_LOCK_INIT;
+    cpu_ticket_lock_acquire(&ticket_lock);
+    ETEST_ASSERT_EQ(cpu_ticket_lock_try_acquire(&ticket_lock), LCPU_FALSE);
+    cpu_ticket_lock_release(&ticket_lock);
+    ETEST_ASSERT_EQ(cpu_ticket_lock_try_acquire(&ticket_lock), LCPU_TRUE);
+    cpu_ticket_lock_release(&ticket_lock);
+
+    CPUMCSLock mcs_lock = CPU_MCS_LOCK_INIT;
+    CPUMCSNode node;
+    CPUMCSNode other_node;
+    cpu_mcs_lock_acquire(&mcs_lock, &node);
+    ETEST_ASSERT_EQ(cpu_mcs_lock_try_acquire(&mcs_lock, &other_node), LCPU_FALSE);
+    cpu_mcs_lock_release(&mcs_lock, &node);
+    ETEST_ASSERT_EQ(cpu_mcs_lock_try_acquire(&mcs_lock, &other_node), LCPU_TRUE);
+    cpu_mcs_lock_release(&mcs_lock, &other_node);
+    ETEST_ASSERT_EQ(mcs_lock.tail, nullptr);
+}
+
 ETEST_DEFINE_TEST(test_popcnt16) {
     ETEST_ASSERT_EQ(cpu_popcnt16(0), 0);
     ETEST_ASSERT_EQ(cpu_popcnt16(1), 1);
@@ -89,4 +422,63 @@ ETEST_DEFINE_TEST(test_popcnt64) {
     ETEST_ASSERT_EQ(cpu_popcnt64(1), 1);
     ETEST_ASSERT_EQ(cpu_popcnt64(0b1100110011001100), 8);
     ETEST_ASSERT_EQ(cpu_popcnt64(0b1111111111111111), 16);
-}
\ No newline at end of file
+}
+
+ETEST_DEFINE_TEST(test_popcnt_buffer) {
+    cpu_u8 data[1027];
+    cpu_u8 mask[1027];
+    for(cpu_usize index = 0; index < sizeof(data); ++index) {
+        data[index] = 0b10110110;// 5 bits
+        mask[index] = 0b00001111;// 2 bits in common
+    }
+    ETEST_ASSERT_EQ(cpu_popcnt_buffer(data, 0), 0);
+    ETEST_ASSERT_EQ(cpu_popcnt_buffer(data, sizeof(data)), sizeof(data) * 5);
+    ETEST_ASSERT_EQ(cpu_popcnt_buffer(data + 3, sizeof(data) - 3), (sizeof(data) - 3) * 5);
+    ETEST_ASSERT_EQ(cpu_popcnt_buffer_and(data, mask, sizeof(data)), sizeof(data) * 2);
+    ETEST_ASSERT_EQ(cpu_popcnt_buffer_and(data + 1, mask + 2, sizeof(data) - 2), (sizeof(data) - 2) * 2);
+}
+
+ETEST_DEFINE_TEST(test_memcpy) {
+    cpu_u8 src[1031];
+    cpu_u8 dst[1031];
+    for(cpu_usize index = 0; index < sizeof(src); ++index) {
+        src[index] = (cpu_u8) (index * 7);
+    }
+    for(cpu_usize size = 0; size < sizeof(src) - 3; size += 13) {
+        cpu_memset(dst, 0, sizeof(dst));
+        ETEST_ASSERT_EQ(cpu_memcpy(dst + 1, src + 3, size), dst + 1);
+        ETEST_ASSERT_EQ(dst[0], 0);
+        ETEST_ASSERT_EQ(dst[size + 1], 0);
+        for(cpu_usize index = 0; index < size; ++index) {
+            ETEST_ASSERT_EQ(dst[index + 1], src[index + 3]);
+        }
+    }
+}
+
+ETEST_DEFINE_TEST(test_memmove) {
+    cpu_u8 data[1031];
+    for(cpu_usize index = 0; index < sizeof(data); ++index) {
+        data[index] = (cpu_u8) index;
+    }
+    cpu_memmove(data + 5, data, 1000);// Overlapping, dst above src
+    for(cpu_usize index = 0; index < 1000; ++index) {
+        ETEST_ASSERT_EQ(data[index + 5], (cpu_u8) index);
+    }
+    cpu_memmove(data, data + 5, 1000);// Overlapping, dst below src
+    for(cpu_usize index = 0; index < 1000; ++index) {
+        ETEST_ASSERT_EQ(data[index], (cpu_u8) index);
+    }
+}
+
+ETEST_DEFINE_TEST(test_memset) {
+    cpu_u8 data[1031];
+    for(cpu_usize size = 0; size < sizeof(data) - 2; size += 11) {
+        ETEST_ASSERT_EQ(cpu_memset(data, 0x00, sizeof(data)), data);
+        cpu_memset(data + 1, 0xA5, size);
+        ETEST_ASSERT_EQ(data[0], 0x00);
+        ETEST_ASSERT_EQ(data[size + 1], 0x00);
+        for(cpu_usize index = 0; index < size; ++index) {
+            ETEST_ASSERT_EQ(data[index + 1], 0xA5);
+        }
+    }
+}